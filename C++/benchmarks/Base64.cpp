@@ -0,0 +1,49 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+
+#include <Utilities/Misc.h>
+
+using namespace std;
+using namespace util;
+
+static const word bytes_per_run = 256 * 1024 * 1024;
+
+template<typename F> float64 run(word length, F&& operation) {
+	word rounds = bytes_per_run / length;
+
+	auto start = chrono::steady_clock::now();
+
+	for (word i = 0; i < rounds; i++)
+		operation();
+
+	auto elapsed = chrono::duration_cast<chrono::duration<float64>>(chrono::steady_clock::now() - start).count();
+
+	return static_cast<float64>(rounds) * length / elapsed / 1000000000.0;
+}
+
+int main() {
+	cout << setw(10) << "bytes" << setw(12) << "encode" << setw(12) << "decode" << setw(12) << "url encode" << setw(12) << "url decode" << "   (GB/s of binary data)" << endl;
+
+	for (word length : { 64, 1024, 65536, 1048576 }) {
+		vector<uint8> data(length), decoded(misc::base64_decoded_size(misc::base64_encoded_size(length)));
+		vector<char> encoded(misc::base64_encoded_size(length));
+
+		for (word i = 0; i < length; i++)
+			data[i] = static_cast<uint8>(i * 131 + 7);
+
+		cout << setw(10) << length << fixed << setprecision(2);
+
+		for (auto alphabet : { misc::base64_alphabet::standard, misc::base64_alphabet::url }) {
+			misc::base64_encode(data.data(), length, encoded.data(), alphabet);
+
+			cout << setw(12) << run(length, [&] { misc::base64_encode(data.data(), length, encoded.data(), alphabet); });
+			cout << setw(12) << run(length, [&] { misc::base64_decode(encoded.data(), static_cast<word>(encoded.size()), decoded.data(), alphabet); });
+		}
+
+		cout << endl;
+	}
+
+	return 0;
+}
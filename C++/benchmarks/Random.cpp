@@ -0,0 +1,48 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+
+#include <Utilities/Cryptography.h>
+
+using namespace std;
+using namespace util;
+
+static const word values_per_run = 16 * 1024 * 1024;
+static const word batch = 4096;
+
+template<typename F> float64 run(F&& operation) {
+	auto start = chrono::steady_clock::now();
+
+	for (word i = 0; i < values_per_run / batch; i++)
+		operation();
+
+	auto elapsed = chrono::duration_cast<chrono::duration<float64>>(chrono::steady_clock::now() - start).count();
+
+	return values_per_run / elapsed / 1000000.0;
+}
+
+int main() {
+	vector<int64> integers(batch);
+	vector<float64> reals(batch);
+
+	float64 single = run([&] {
+		uniform_int_distribution<int64> distribution(-1000, 1000);
+
+		for (auto& i : integers)
+			i = distribution(crypto::generator());
+	});
+
+	float64 small = run([&] { crypto::fill_uniform_int64(span<int64>(integers.data(), batch), -1000, 1000); });
+	float64 wide = run([&] { crypto::fill_uniform_int64(span<int64>(integers.data(), batch), 0, 1LL << 50); });
+	float64 real = run([&] { crypto::fill_uniform_float64(span<float64>(reals.data(), batch), 0.0, 1.0); });
+
+	cout << fixed << setprecision(1) << "(million values/s)" << endl;
+	cout << setw(36) << left << "uniform_int_distribution [-1000, 1000]" << setw(10) << right << single << endl;
+	cout << setw(36) << left << "fill_uniform_int64 [-1000, 1000]" << setw(10) << right << small << endl;
+	cout << setw(36) << left << "fill_uniform_int64 [0, 2^50]" << setw(10) << right << wide << endl;
+	cout << setw(36) << left << "fill_uniform_float64 [0, 1)" << setw(10) << right << real << endl;
+
+	return 0;
+}
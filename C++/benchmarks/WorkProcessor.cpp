@@ -0,0 +1,50 @@
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+#include <Utilities/WorkProcessor.h>
+
+using namespace std;
+using namespace util;
+
+static const word roots = 1000;
+static const word depth = 100;
+
+float64 run(word workers, work_scheduling scheduling) {
+	work_processor<word> processor(workers, chrono::microseconds(0), scheduling);
+	atomic<word> processed(0);
+
+	processor.on_item += [&processor, &processed](word, word& item) {
+		if (item > 1)
+			processor.add_work(item - 1);
+
+		processed.fetch_add(1, memory_order_relaxed);
+	};
+
+	auto start = chrono::steady_clock::now();
+
+	processor.start();
+
+	for (word i = 0; i < roots; i++)
+		processor.add_work(word(depth));
+
+	while (processed.load() < roots * depth)
+		this_thread::yield();
+
+	auto elapsed = chrono::duration_cast<chrono::duration<float64>>(chrono::steady_clock::now() - start).count();
+
+	processor.stop();
+
+	return roots * depth / elapsed / 1000000.0;
+}
+
+int main() {
+	cout << setw(8) << "workers" << setw(16) << "shared" << setw(16) << "stealing" << "   (million items/s)" << endl;
+
+	for (word workers : { 1, 4, 16, 64 })
+		cout << setw(8) << workers << setw(16) << fixed << setprecision(2) << run(workers, work_scheduling::shared) << setw(16) << run(workers, work_scheduling::work_stealing) << endl;
+
+	return 0;
+}
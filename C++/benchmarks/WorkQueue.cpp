@@ -0,0 +1,65 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+#include <Utilities/WorkQueue.h>
+#include <Utilities/RingQueue.h>
+
+using namespace std;
+using namespace util;
+
+static const word items_per_producer = 200000;
+
+template<typename Q> float64 run(Q& queue, word threads) {
+	vector<thread> producers;
+	vector<thread> consumers;
+	atomic<word> remaining(items_per_producer * threads);
+
+	auto start = chrono::steady_clock::now();
+
+	for (word i = 0; i < threads; i++) {
+		consumers.emplace_back([&queue, &remaining] {
+			uint64 item;
+
+			while (queue.dequeue(item))
+				if (remaining.fetch_sub(1) == 1)
+					queue.kill_waiters();
+		});
+	}
+
+	for (word i = 0; i < threads; i++) {
+		producers.emplace_back([&queue] {
+			for (uint64 j = 0; j < items_per_producer; j++)
+				queue.enqueue(move(j));
+		});
+	}
+
+	for (auto& i : producers)
+		i.join();
+
+	for (auto& i : consumers)
+		i.join();
+
+	auto elapsed = chrono::duration_cast<chrono::duration<float64>>(chrono::steady_clock::now() - start).count();
+
+	return (items_per_producer * threads) / elapsed / 1000000.0;
+}
+
+int main() {
+	cout << setw(8) << "threads" << setw(16) << "work_queue" << setw(16) << "ring_queue" << "   (million items/s)" << endl;
+
+	for (word threads : { 1, 4, 16, 64 }) {
+		work_queue<uint64> locked;
+		ring_queue<uint64> ring(4096);
+
+		float64 a = run(locked, threads);
+		float64 b = run(ring, threads);
+
+		cout << setw(8) << threads << setw(16) << fixed << setprecision(2) << a << setw(16) << b << endl;
+	}
+
+	return 0;
+}
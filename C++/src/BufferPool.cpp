@@ -0,0 +1,221 @@
+#include "BufferPool.h"
+
+#include <atomic>
+
+using namespace std;
+using namespace util;
+
+namespace {
+	//A thread keeps a separate cache for every pool it touches, keyed by an id
+	//that is never reused, and frees whatever is left in them when it exits.
+	enum class cache_status : uint8 {
+		unused,
+		alive,
+		destroyed
+	};
+
+	//Plain thread storage outlives the cache itself, so it can tell a thread
+	//exit destructor that runs after the cache is gone not to touch it.
+	threadlocal cache_status status = cache_status::unused;
+
+	atomic<uint64> next_pool_id(0);
+
+	typedef array<vector<uint8*>, caching_buffer_pool::size_classes> class_buffers;
+
+	struct pool_cache {
+		uint64 pool;
+		class_buffers buffers;
+	};
+
+	struct thread_cache {
+		vector<pool_cache> pools;
+
+		thread_cache() {
+			status = cache_status::alive;
+		}
+
+		~thread_cache() {
+			status = cache_status::destroyed;
+
+			for (auto& i : this->pools)
+				thread_cache::free(i.buffers);
+		}
+
+		class_buffers& buffers_for(uint64 pool) {
+			for (auto& i : this->pools)
+				if (i.pool == pool)
+					return i.buffers;
+
+			this->pools.emplace_back();
+			this->pools.back().pool = pool;
+
+			return this->pools.back().buffers;
+		}
+
+		void forget(uint64 pool) {
+			for (auto i = this->pools.begin(); i != this->pools.end(); ++i) {
+				if (i->pool == pool) {
+					thread_cache::free(i->buffers);
+					this->pools.erase(i);
+					return;
+				}
+			}
+		}
+
+		static void free(class_buffers& buffers) {
+			for (auto& i : buffers)
+				for (auto j : i)
+					delete[] j;
+		}
+	};
+
+	thread_local thread_cache cache;
+
+	/**
+	 * @returns this thread's cache, or nullptr if it has already been
+	 * destroyed during thread exit
+	 */
+	thread_cache* local_cache() {
+		return status == cache_status::destroyed ? nullptr : &cache;
+	}
+}
+
+buffer_pool::~buffer_pool() {
+
+}
+
+buffer_pool& buffer_pool::shared() {
+	static caching_buffer_pool* pool = new caching_buffer_pool();
+
+	return *pool;
+}
+
+caching_buffer_pool::caching_buffer_pool(word depot_limit) {
+	this->depot_limit = depot_limit;
+	this->depot_size = 0;
+	this->id = next_pool_id.fetch_add(1, memory_order_relaxed);
+}
+
+caching_buffer_pool::~caching_buffer_pool() {
+	//Other threads' caches for this pool can't be reached from here and are
+	//freed when those threads exit.
+	if (status == cache_status::alive)
+		cache.forget(this->id);
+
+	for (auto& i : this->depot)
+		for (auto j : i)
+			delete[] j;
+}
+
+word caching_buffer_pool::size_class(word size) {
+	if (size > caching_buffer_pool::max_size || (size & (size - 1)) != 0)
+		return caching_buffer_pool::size_classes;
+
+	word bits = caching_buffer_pool::min_size_bits;
+	while ((static_cast<word>(1) << bits) < size)
+		bits++;
+
+	return bits - caching_buffer_pool::min_size_bits;
+}
+
+word caching_buffer_pool::class_size(word index) {
+	return static_cast<word>(1) << (index + caching_buffer_pool::min_size_bits);
+}
+
+void caching_buffer_pool::deposit(uint8* buffer, word index) {
+	word size = caching_buffer_pool::class_size(index);
+
+	if (this->depot_size + size <= this->depot_limit) {
+		this->depot[index].push_back(buffer);
+		this->depot_size += size;
+	}
+	else {
+		delete[] buffer;
+	}
+}
+
+uint8* caching_buffer_pool::withdraw(word index) {
+	auto& shared = this->depot[index];
+
+	if (shared.empty())
+		return nullptr;
+
+	uint8* buffer = shared.back();
+	shared.pop_back();
+	this->depot_size -= caching_buffer_pool::class_size(index);
+
+	return buffer;
+}
+
+uint8* caching_buffer_pool::allocate(word size) {
+	word index = caching_buffer_pool::size_class(size);
+
+	if (index == caching_buffer_pool::size_classes)
+		return new uint8[size];
+
+	thread_cache* current = local_cache();
+
+	if (!current) {
+		unique_lock<mutex> lck(this->lock);
+		uint8* buffer = this->withdraw(index);
+
+		lck.unlock();
+
+		return buffer ? buffer : new uint8[caching_buffer_pool::class_size(index)];
+	}
+
+	auto& local = current->buffers_for(this->id)[index];
+
+	if (local.empty()) {
+		unique_lock<mutex> lck(this->lock);
+
+		for (word i = 0; i < caching_buffer_pool::thread_cache_limit / 2; i++) {
+			uint8* buffer = this->withdraw(index);
+
+			if (!buffer)
+				break;
+
+			local.push_back(buffer);
+		}
+	}
+
+	if (local.empty())
+		return new uint8[caching_buffer_pool::class_size(index)];
+
+	uint8* buffer = local.back();
+	local.pop_back();
+
+	return buffer;
+}
+
+void caching_buffer_pool::release(uint8* buffer, word size) {
+	word index = caching_buffer_pool::size_class(size);
+
+	if (index == caching_buffer_pool::size_classes) {
+		delete[] buffer;
+		return;
+	}
+
+	thread_cache* current = local_cache();
+
+	if (!current) {
+		unique_lock<mutex> lck(this->lock);
+
+		this->deposit(buffer, index);
+
+		return;
+	}
+
+	auto& local = current->buffers_for(this->id)[index];
+
+	if (local.size() >= caching_buffer_pool::thread_cache_limit) {
+		unique_lock<mutex> lck(this->lock);
+
+		while (local.size() > caching_buffer_pool::thread_cache_limit / 2) {
+			this->deposit(local.back(), index);
+			local.pop_back();
+		}
+	}
+
+	local.push_back(buffer);
+}
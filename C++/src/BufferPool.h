@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <mutex>
+
+#include "Common.h"
+
+namespace util {
+	/**
+	* Source of the heap buffers behind a data_stream. A buffer must be
+	* released to the pool it came from with the size it was allocated with.
+	*/
+	class buffer_pool {
+		public:
+			virtual ~buffer_pool();
+
+			/**
+			* @returns a buffer of @a size bytes
+			*/
+			virtual uint8* allocate(word size) = 0;
+
+			/**
+			* Returns @a buffer, allocated with @a size bytes, to the pool.
+			*/
+			virtual void release(uint8* buffer, word size) = 0;
+
+			/**
+			* @returns the caching_buffer_pool used by default. It lives for
+			* the whole process.
+			*/
+			static buffer_pool& shared();
+	};
+
+	/**
+	* Pool of power-of-two sized buffers, matching the growth of
+	* data_stream. Every thread keeps a few free buffers of each size class
+	* for each pool it uses, so most allocations and releases take no lock
+	* and a buffer only ever goes back to the pool it came from. Threads
+	* refill from and overflow into a depot shared through the pool. Sizes
+	* that are not a power of two or are larger than max_size go straight
+	* to the heap.
+	*
+	* Buffers a thread still caches for a destroyed pool are freed when
+	* that thread exits.
+	*/
+	class caching_buffer_pool : public buffer_pool {
+		public:
+			static const word min_size_bits = 6;
+			static const word max_size_bits = 20;
+			static const word max_size = 1 << max_size_bits;
+			static const word size_classes = max_size_bits - min_size_bits + 1;
+			static const word thread_cache_limit = 16;
+			static const word default_depot_limit = 16 * 1024 * 1024;
+
+			/**
+			* @param depot_limit Number of bytes of free buffers, over all
+			* size classes, kept in the shared depot before further ones are
+			* freed.
+			*/
+			caching_buffer_pool(word depot_limit = caching_buffer_pool::default_depot_limit);
+			~caching_buffer_pool();
+
+			caching_buffer_pool(const caching_buffer_pool& other) = delete;
+			caching_buffer_pool(caching_buffer_pool&& other) = delete;
+			caching_buffer_pool& operator=(const caching_buffer_pool& other) = delete;
+			caching_buffer_pool& operator=(caching_buffer_pool&& other) = delete;
+
+			uint8* allocate(word size) override;
+			void release(uint8* buffer, word size) override;
+
+		private:
+			std::array<std::vector<uint8*>, size_classes> depot;
+			std::mutex lock;
+			word depot_limit;
+			word depot_size;
+			uint64 id;
+
+			void deposit(uint8* buffer, word index);
+			uint8* withdraw(word index);
+
+			static word size_class(word size);
+			static word class_size(word index);
+	};
+}
@@ -0,0 +1,96 @@
+#include "ByteOrder.h"
+
+#include <cstring>
+
+#include "CPU.h"
+
+#ifdef X86
+	#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace util;
+
+namespace {
+	bool host_is_little() {
+		uint16 probe = 1;
+
+		return *reinterpret_cast<uint8*>(&probe) == 1;
+	}
+
+	void swap_scalar(uint8* target, const uint8* source, word count, word size) {
+		for (word i = 0; i < count; i++, target += size, source += size)
+			for (word j = 0; j < size; j++)
+				target[j] = source[size - 1 - j];
+	}
+
+#ifdef X86
+	//Shuffle masks that reverse every 2, 4 or 8 byte group in a 16 byte lane.
+	alignas(16) const uint8 masks[3][16] = {
+		{ 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 },
+		{ 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 },
+		{ 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 }
+	};
+
+	const uint8* mask_for(word size) {
+		return masks[size == 2 ? 0 : size == 4 ? 1 : 2];
+	}
+
+	target_ssse3 word swap_ssse3(uint8* target, const uint8* source, word bytes, word size) {
+		__m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(mask_for(size)));
+		word done = 0;
+
+		for (; done + 16 <= bytes; done += 16) {
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + done));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(target + done), _mm_shuffle_epi8(block, mask));
+		}
+
+		return done;
+	}
+
+	target_avx2 word swap_avx2(uint8* target, const uint8* source, word bytes, word size) {
+		__m256i mask = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(mask_for(size))));
+		word done = 0;
+
+		for (; done + 32 <= bytes; done += 32) {
+			__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + done));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(target + done), _mm256_shuffle_epi8(block, mask));
+		}
+
+		return done;
+	}
+#endif
+}
+
+bool byte_order::needs_swap(endianness order) {
+	static const bool little = host_is_little();
+
+	switch (order) {
+		case endianness::little: return !little;
+		case endianness::big: return little;
+		default: return false;
+	}
+}
+
+void byte_order::copy(uint8* target, const uint8* source, word count, word size, endianness order) {
+	if (size == 1 || !byte_order::needs_swap(order))
+		memcpy(target, source, count * size);
+	else
+		byte_order::swap(target, source, count, size);
+}
+
+void byte_order::swap(uint8* target, const uint8* source, word count, word size) {
+	word bytes = count * size;
+	word done = 0;
+
+#ifdef X86
+	if (size == 2 || size == 4 || size == 8) {
+		if (cpu::has_avx2())
+			done = swap_avx2(target, source, bytes, size);
+		else if (cpu::has_ssse3())
+			done = swap_ssse3(target, source, bytes, size);
+	}
+#endif
+
+	swap_scalar(target + done, source + done, (bytes - done) / size, size);
+}
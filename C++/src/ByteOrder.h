@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Common.h"
+
+namespace util {
+	/**
+	* Byte order of values in a buffer.
+	*/
+	enum class endianness {
+		native,
+		little,
+		big
+	};
+
+	namespace byte_order {
+		/**
+		* @returns true if values stored in @a order must be byte-swapped to
+		* be read on this machine
+		*/
+		bool needs_swap(endianness order);
+
+		/**
+		* Copies @a count values of @a size bytes each from @a source to
+		* @a target, converting them between native order and @a order.
+		* Sizes of two, four and eight bytes are swapped with SSSE3 or AVX2
+		* when the processor supports them. The buffers may not overlap.
+		*/
+		void copy(uint8* target, const uint8* source, word count, word size, endianness order);
+
+		/**
+		* Reverses the bytes of each of the @a count values of @a size bytes
+		* while copying them from @a source to @a target.
+		*/
+		void swap(uint8* target, const uint8* source, word count, word size);
+	}
+}
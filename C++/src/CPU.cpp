@@ -0,0 +1,56 @@
+#include "CPU.h"
+
+#if defined X86 && defined WINDOWS
+	#include <intrin.h>
+	#include <immintrin.h>
+#endif
+
+using namespace util;
+
+namespace {
+	struct features {
+		bool ssse3;
+		bool avx2;
+
+		features() {
+			this->ssse3 = false;
+			this->avx2 = false;
+
+#if defined X86 && defined WINDOWS
+			int registers[4];
+
+			__cpuid(registers, 0);
+			int highest = registers[0];
+
+			__cpuid(registers, 1);
+			this->ssse3 = (registers[2] & (1 << 9)) != 0;
+
+			bool os_saves_ymm = (registers[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+
+			if (highest >= 7 && os_saves_ymm) {
+				__cpuidex(registers, 7, 0);
+				this->avx2 = (registers[1] & (1 << 5)) != 0;
+			}
+#elif defined X86
+			__builtin_cpu_init();
+
+			this->ssse3 = __builtin_cpu_supports("ssse3") != 0;
+			this->avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+		}
+	};
+
+	const features& detected() {
+		static features instance;
+
+		return instance;
+	}
+}
+
+bool cpu::has_ssse3() {
+	return detected().ssse3;
+}
+
+bool cpu::has_avx2() {
+	return detected().avx2;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Common.h"
+
+#if defined __x86_64__ || defined __i386__ || defined _M_X64 || defined _M_IX86
+#define X86
+#endif
+
+#if defined X86 && (defined __GNUC__ || defined __clang__)
+#define target_ssse3 __attribute__((target("ssse3")))
+#define target_avx2 __attribute__((target("avx2")))
+#else
+#define target_ssse3
+#define target_avx2
+#endif
+
+namespace util {
+	/**
+	* Instruction set extensions available on the processor we are running
+	* on, detected once on first use. Always false on non-x86 targets.
+	*/
+	namespace cpu {
+		bool has_ssse3();
+		bool has_avx2();
+	}
+}
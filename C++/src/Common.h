@@ -11,6 +11,12 @@
 #endif
 
 #include <chrono>
+#include <new>
+#include <cstdlib>
+
+#ifdef WINDOWS
+	#include <malloc.h>
+#endif
 
 typedef long long int64;
 typedef int int32;
@@ -55,3 +61,43 @@ typedef int32 sword;
 
 typedef const char* cstr;
 typedef word uintptr;
+
+namespace util {
+	/**
+	* Base for types that must start on their own cache line when created
+	* with new, which ignores alignas beyond max_align_t before C++17.
+	*/
+	struct alignas(64) cache_line_aligned {
+		static void* operator new(std::size_t size) {
+			void* result;
+
+#ifdef WINDOWS
+			result = _aligned_malloc(size, 64);
+#else
+			if (posix_memalign(&result, 64, size) != 0)
+				result = nullptr;
+#endif
+
+			if (!result)
+				throw std::bad_alloc();
+
+			return result;
+		}
+
+		static void* operator new[](std::size_t size) {
+			return cache_line_aligned::operator new(size);
+		}
+
+		static void operator delete(void* pointer) {
+#ifdef WINDOWS
+			_aligned_free(pointer);
+#else
+			std::free(pointer);
+#endif
+		}
+
+		static void operator delete[](void* pointer) {
+			cache_line_aligned::operator delete(pointer);
+		}
+	};
+}
@@ -1,97 +1,640 @@
 #include "Cryptography.h"
 
+#include <utility>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "CPU.h"
+#include "DataStream.h"
+#include "SegmentedStream.h"
+
 #ifdef WINDOWS
 	#define WIN32_LEAN_AND_MEAN
 	#include <Windows.h>
 	#include <wincrypt.h>
+	#include <intrin.h>
 #elif defined POSIX
 	#include <openssl/evp.h>
+	#include <pthread.h>
+#endif
+
+#ifdef X86
+	#include <immintrin.h>
 #endif
 
 using namespace std;
 using namespace util;
 using namespace util::crypto;
 
-random_device crypto::device;
-mt19937_64 crypto::generator(crypto::device());
 
-array<uint8, crypto::sha2_length> crypto::calculate_sha2(const uint8* source, word length) {
-	array<uint8, crypto::sha2_length> result;
+#ifdef WINDOWS
+struct hasher::context {
+	HCRYPTPROV provider;
+	HCRYPTHASH hash;
+};
+#elif defined POSIX
+struct hasher::context {
+	EVP_MD_CTX* ctx;
+};
+
+namespace {
+	/**
+	 * One context per algorithm for each thread, initialized once. Copying
+	 * an initialized context is much cheaper than initializing a new one.
+	 */
+	struct initialized_contexts {
+		EVP_MD_CTX* sha1;
+		EVP_MD_CTX* sha2;
+
+		initialized_contexts() {
+			this->sha1 = EVP_MD_CTX_create();
+			this->sha2 = EVP_MD_CTX_create();
+
+			EVP_DigestInit_ex(this->sha1, EVP_sha1(), nullptr);
+			EVP_DigestInit_ex(this->sha2, EVP_sha512(), nullptr);
+		}
+
+		~initialized_contexts() {
+			EVP_MD_CTX_destroy(this->sha1);
+			EVP_MD_CTX_destroy(this->sha2);
+		}
+
+		const EVP_MD_CTX* get(hash_algorithm algorithm) const {
+			return algorithm == hash_algorithm::sha1 ? this->sha1 : this->sha2;
+		}
+	};
 
+	thread_local initialized_contexts initialized;
+}
+#endif
+
+namespace {
+	/**
+	 * @returns this thread's hasher for @a algorithm, so one-shot hashes
+	 * don't pay for creating and destroying a context on every call
+	 */
+	hasher& cached_hasher(hash_algorithm algorithm) {
+		thread_local hasher sha1(hash_algorithm::sha1);
+		thread_local hasher sha2(hash_algorithm::sha2);
+
+		hasher& result = algorithm == hash_algorithm::sha1 ? sha1 : sha2;
+
+		result.reset();
+
+		return result;
+	}
+}
+
+hasher::hasher(hash_algorithm algorithm) : state(new context()), algorithm(algorithm) {
 #ifdef WINDOWS
-	HCRYPTPROV provider = 0;
-	HCRYPTHASH hasher = 0;
-	DWORD hash_length = crypto::sha2_length;
+	CryptAcquireContext(&this->state->provider, nullptr, nullptr, PROV_RSA_AES, CRYPT_VERIFYCONTEXT);
+#elif defined POSIX
+	this->state->ctx = EVP_MD_CTX_create();
+#endif
 
-	CryptAcquireContext(&provider, nullptr, nullptr, PROV_RSA_AES, CRYPT_VERIFYCONTEXT);
-	CryptCreateHash(provider, CALG_SHA_512, 0, 0, &hasher);
-	CryptHashData(hasher, source, static_cast<DWORD>(length), 0);
+	this->reset();
+}
 
-	CryptGetHashParam(hasher, HP_HASHVAL, result.data(), &hash_length, 0);
+hasher::hasher(hasher&& other) : state(nullptr), algorithm(other.algorithm) {
+	*this = move(other);
+}
 
-	CryptDestroyHash(hasher);
-	CryptReleaseContext(provider, 0);
+hasher::~hasher() {
+	if (!this->state)
+		return;
+
+#ifdef WINDOWS
+	if (this->state->hash)
+		CryptDestroyHash(this->state->hash);
+
+	CryptReleaseContext(this->state->provider, 0);
 #elif defined POSIX
-	EVP_MD_CTX *ctx = EVP_MD_CTX_create();
+	EVP_MD_CTX_destroy(this->state->ctx);
+#endif
+
+	delete this->state;
+}
+
+hasher& hasher::operator=(hasher&& other) {
+	swap(this->state, other.state);
+	swap(this->algorithm, other.algorithm);
+
+	return *this;
+}
+
+word hasher::length() const {
+	return this->algorithm == hash_algorithm::sha1 ? crypto::sha1_length : crypto::sha2_length;
+}
+
+void hasher::update(const uint8* source, word length) {
+#ifdef WINDOWS
+	CryptHashData(this->state->hash, source, static_cast<DWORD>(length), 0);
+#elif defined POSIX
+	EVP_DigestUpdate(this->state->ctx, source, length);
+#endif
+}
+
+void hasher::update(const data_stream& stream) {
+	this->update(stream.data(), stream.size());
+}
+
+void hasher::update(const segmented_stream& stream) {
+	for (auto& i : stream.segments())
+		this->update(i.data, i.length);
+}
+
+void hasher::final(uint8* result) {
+#ifdef WINDOWS
+	DWORD hash_length = static_cast<DWORD>(this->length());
+
+	CryptGetHashParam(this->state->hash, HP_HASHVAL, result, &hash_length, 0);
+#elif defined POSIX
+	EVP_DigestFinal_ex(this->state->ctx, reinterpret_cast<unsigned char*>(result), nullptr);
+#endif
+}
 
-	EVP_DigestInit_ex(ctx, EVP_sha512(), nullptr);
-	EVP_DigestUpdate(ctx, const_cast<void*>(reinterpret_cast<const void*>(source)), length);
-	EVP_DigestFinal_ex(ctx, reinterpret_cast<unsigned char*>(result.data()), nullptr);
+void hasher::reset() {
+#ifdef WINDOWS
+	if (this->state->hash)
+		CryptDestroyHash(this->state->hash);
 
-	EVP_MD_CTX_destroy(ctx);
+	CryptCreateHash(this->state->provider, this->algorithm == hash_algorithm::sha1 ? CALG_SHA1 : CALG_SHA_512, 0, 0, &this->state->hash);
+#elif defined POSIX
+	EVP_MD_CTX_copy_ex(this->state->ctx, initialized.get(this->algorithm));
 #endif
+}
+
+array<uint8, crypto::sha2_length> crypto::calculate_sha2(const uint8* source, word length) {
+	array<uint8, crypto::sha2_length> result;
+	hasher& hash = cached_hasher(hash_algorithm::sha2);
+
+	hash.update(source, length);
+	hash.final(result.data());
 
 	return result;
 }
 
 array<uint8, crypto::sha1_length> crypto::calculate_sha1(const uint8* source, word length) {
 	array<uint8, crypto::sha1_length> result;
+	hasher& hash = cached_hasher(hash_algorithm::sha1);
 
-#ifdef WINDOWS
-	HCRYPTPROV provider = 0;
-	HCRYPTHASH hasher = 0;
-	DWORD hash_length = crypto::sha1_length;
+	hash.update(source, length);
+	hash.final(result.data());
 
-	CryptAcquireContext(&provider, nullptr, nullptr, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT);
-	CryptCreateHash(provider, CALG_SHA1, 0, 0, &hasher);
-	CryptHashData(hasher, source, static_cast<DWORD>(length), 0);
+	return result;
+}
 
-	CryptGetHashParam(hasher, HP_HASHVAL, result.data(), &hash_length, 0);
+namespace {
+	uint32 rotate(uint32 value, word bits) {
+		return (value << bits) | (value >> (32 - bits));
+	}
 
-	CryptDestroyHash(hasher);
-	CryptReleaseContext(provider, 0);
-#elif defined POSIX
-	EVP_MD_CTX *ctx = EVP_MD_CTX_create();
+	void quarter_round(uint32& a, uint32& b, uint32& c, uint32& d) {
+		a += b; d = rotate(d ^ a, 16);
+		c += d; b = rotate(b ^ c, 12);
+		a += b; d = rotate(d ^ a, 8);
+		c += d; b = rotate(b ^ c, 7);
+	}
+
+	const uint32 chacha20_constants[4] = { 0x61707865, 0x3320646E, 0x79622D32, 0x6B206574 };
+
+	/**
+	 * Writes the ChaCha20 block for @a key, block @a counter and a zero
+	 * nonce to @a output.
+	 */
+	void chacha20_block(const uint32* key, uint32 counter, uint8* output) {
+		uint32 input[16];
+		uint32 state[16];
+
+		memcpy(input, chacha20_constants, 16);
+		memcpy(input + 4, key, 32);
+		input[12] = counter;
+		input[13] = input[14] = input[15] = 0;
+
+		memcpy(state, input, sizeof(state));
+
+		for (word i = 0; i < 10; i++) {
+			quarter_round(state[0], state[4], state[8], state[12]);
+			quarter_round(state[1], state[5], state[9], state[13]);
+			quarter_round(state[2], state[6], state[10], state[14]);
+			quarter_round(state[3], state[7], state[11], state[15]);
+			quarter_round(state[0], state[5], state[10], state[15]);
+			quarter_round(state[1], state[6], state[11], state[12]);
+			quarter_round(state[2], state[7], state[8], state[13]);
+			quarter_round(state[3], state[4], state[9], state[14]);
+		}
+
+		for (word i = 0; i < 16; i++) {
+			uint32 value = state[i] + input[i];
+
+			output[4 * i + 0] = static_cast<uint8>(value);
+			output[4 * i + 1] = static_cast<uint8>(value >> 8);
+			output[4 * i + 2] = static_cast<uint8>(value >> 16);
+			output[4 * i + 3] = static_cast<uint8>(value >> 24);
+		}
+	}
+
+#ifdef X86
+	//The vector versions run consecutive blocks side by side, one per lane,
+	//and store the words as they sit in the registers: word n of every block
+	//before word n + 1. That reorders the keystream but is just as random.
+	template<int bits> target_ssse3 __m128i rotate_ssse3(__m128i value) {
+		return _mm_or_si128(_mm_slli_epi32(value, bits), _mm_srli_epi32(value, 32 - bits));
+	}
+
+	target_ssse3 void quarter_round_ssse3(__m128i& a, __m128i& b, __m128i& c, __m128i& d) {
+		a = _mm_add_epi32(a, b); d = rotate_ssse3<16>(_mm_xor_si128(d, a));
+		c = _mm_add_epi32(c, d); b = rotate_ssse3<12>(_mm_xor_si128(b, c));
+		a = _mm_add_epi32(a, b); d = rotate_ssse3<8>(_mm_xor_si128(d, a));
+		c = _mm_add_epi32(c, d); b = rotate_ssse3<7>(_mm_xor_si128(b, c));
+	}
+
+	target_ssse3 void chacha20_blocks_ssse3(const uint32* key, uint32 counter, uint8* output) {
+		__m128i input[16];
+		__m128i state[16];
+
+		for (word i = 0; i < 4; i++)
+			input[i] = _mm_set1_epi32(static_cast<int>(chacha20_constants[i]));
+
+		for (word i = 0; i < 8; i++)
+			input[4 + i] = _mm_set1_epi32(static_cast<int>(key[i]));
+
+		input[12] = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(counter)), _mm_setr_epi32(0, 1, 2, 3));
+		input[13] = input[14] = input[15] = _mm_setzero_si128();
+
+		for (word i = 0; i < 16; i++)
+			state[i] = input[i];
+
+		for (word i = 0; i < 10; i++) {
+			quarter_round_ssse3(state[0], state[4], state[8], state[12]);
+			quarter_round_ssse3(state[1], state[5], state[9], state[13]);
+			quarter_round_ssse3(state[2], state[6], state[10], state[14]);
+			quarter_round_ssse3(state[3], state[7], state[11], state[15]);
+			quarter_round_ssse3(state[0], state[5], state[10], state[15]);
+			quarter_round_ssse3(state[1], state[6], state[11], state[12]);
+			quarter_round_ssse3(state[2], state[7], state[8], state[13]);
+			quarter_round_ssse3(state[3], state[4], state[9], state[14]);
+		}
+
+		for (word i = 0; i < 16; i++)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 16 * i), _mm_add_epi32(state[i], input[i]));
+	}
+
+	template<int bits> target_avx2 __m256i rotate_avx2(__m256i value) {
+		return _mm256_or_si256(_mm256_slli_epi32(value, bits), _mm256_srli_epi32(value, 32 - bits));
+	}
+
+	target_avx2 void quarter_round_avx2(__m256i& a, __m256i& b, __m256i& c, __m256i& d) {
+		a = _mm256_add_epi32(a, b); d = rotate_avx2<16>(_mm256_xor_si256(d, a));
+		c = _mm256_add_epi32(c, d); b = rotate_avx2<12>(_mm256_xor_si256(b, c));
+		a = _mm256_add_epi32(a, b); d = rotate_avx2<8>(_mm256_xor_si256(d, a));
+		c = _mm256_add_epi32(c, d); b = rotate_avx2<7>(_mm256_xor_si256(b, c));
+	}
+
+	target_avx2 void chacha20_blocks_avx2(const uint32* key, uint32 counter, uint8* output) {
+		__m256i input[16];
+		__m256i state[16];
+
+		for (word i = 0; i < 4; i++)
+			input[i] = _mm256_set1_epi32(static_cast<int>(chacha20_constants[i]));
+
+		for (word i = 0; i < 8; i++)
+			input[4 + i] = _mm256_set1_epi32(static_cast<int>(key[i]));
+
+		input[12] = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(counter)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+		input[13] = input[14] = input[15] = _mm256_setzero_si256();
+
+		for (word i = 0; i < 16; i++)
+			state[i] = input[i];
+
+		for (word i = 0; i < 10; i++) {
+			quarter_round_avx2(state[0], state[4], state[8], state[12]);
+			quarter_round_avx2(state[1], state[5], state[9], state[13]);
+			quarter_round_avx2(state[2], state[6], state[10], state[14]);
+			quarter_round_avx2(state[3], state[7], state[11], state[15]);
+			quarter_round_avx2(state[0], state[5], state[10], state[15]);
+			quarter_round_avx2(state[1], state[6], state[11], state[12]);
+			quarter_round_avx2(state[2], state[7], state[8], state[13]);
+			quarter_round_avx2(state[3], state[4], state[9], state[14]);
+		}
+
+		for (word i = 0; i < 16; i++)
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + 32 * i), _mm256_add_epi32(state[i], input[i]));
+	}
+#endif
+
+	uint64 forks = 0;
+
+	void count_fork() {
+		forks++;
+	}
+
+	/**
+	 * @returns how many times this process or its ancestors have forked
+	 * since the first call, which is cheap enough to check on every draw
+	 * unlike getpid
+	 */
+	uint64 fork_count() {
+#ifdef POSIX
+		static bool registered = pthread_atfork(nullptr, nullptr, count_fork) == 0;
 
-	EVP_DigestInit_ex(ctx, EVP_sha1(), nullptr);
-	EVP_DigestUpdate(ctx, const_cast<void*>(reinterpret_cast<const void*>(source)), length);
-	EVP_DigestFinal_ex(ctx, reinterpret_cast<unsigned char*>(result.data()), nullptr);
+		static_cast<void>(registered);
 #endif
 
+		return forks;
+	}
+}
+
+chacha20_generator::chacha20_generator() {
+	memset(this->key, 0, sizeof(this->key));
+
+	this->reseed();
+}
+
+void chacha20_generator::reseed() {
+	random_device device;
+
+	for (auto& i : this->key)
+		i ^= static_cast<uint32>(device());
+
+	memset(this->buffer, 0, sizeof(this->buffer));
+
+	this->generation = fork_count();
+	this->until_reseed = chacha20_generator::reseed_interval;
+	this->available = 0;
+}
+
+void chacha20_generator::refill() {
+	if (this->until_reseed < chacha20_generator::buffer_size)
+		this->reseed();
+
+	word blocks = chacha20_generator::buffer_size / chacha20_generator::block_size, done = 0;
+
+#ifdef X86
+	if (cpu::has_avx2()) {
+		for (; done < blocks; done += 8)
+			chacha20_blocks_avx2(this->key, static_cast<uint32>(done), this->buffer + done * chacha20_generator::block_size);
+	}
+	else if (cpu::has_ssse3()) {
+		for (; done < blocks; done += 4)
+			chacha20_blocks_ssse3(this->key, static_cast<uint32>(done), this->buffer + done * chacha20_generator::block_size);
+	}
+#endif
+
+	for (; done < blocks; done++)
+		chacha20_block(this->key, static_cast<uint32>(done), this->buffer + done * chacha20_generator::block_size);
+
+	memcpy(this->key, this->buffer, chacha20_generator::key_size);
+	memset(this->buffer, 0, chacha20_generator::key_size);
+
+	this->available = chacha20_generator::buffer_size - chacha20_generator::key_size;
+	this->until_reseed -= chacha20_generator::buffer_size;
+}
+
+void chacha20_generator::generate(uint8* target, word count) {
+	//A child process after fork would otherwise repeat its parent's buffered output.
+	if (this->generation != fork_count())
+		this->reseed();
+
+	while (count > 0) {
+		if (this->available == 0)
+			this->refill();
+
+		word taken = count < this->available ? count : this->available;
+		uint8* source = this->buffer + chacha20_generator::buffer_size - this->available;
+
+		memcpy(target, source, taken);
+		memset(source, 0, taken);
+
+		this->available -= taken;
+		target += taken;
+		count -= taken;
+	}
+}
+
+chacha20_generator::result_type chacha20_generator::operator()() {
+	result_type result;
+
+	if (this->available >= sizeof(result) && this->generation == fork_count()) {
+		uint8* source = this->buffer + chacha20_generator::buffer_size - this->available;
+
+		memcpy(&result, source, sizeof(result));
+		memset(source, 0, sizeof(result));
+
+		this->available -= sizeof(result);
+	}
+	else {
+		this->generate(reinterpret_cast<uint8*>(&result), sizeof(result));
+	}
+
 	return result;
 }
 
+chacha20_generator& crypto::generator() {
+	thread_local chacha20_generator instance;
+
+	return instance;
+}
+
 void crypto::random_bytes(uint8* buffer, word count) {
-	uniform_int_distribution<uint64> distribution;
+	crypto::generator().generate(buffer, count);
+}
 
-	if (count > 0) {
-		for (; count > 7; count -= 8)
-			*reinterpret_cast<uint64*>(buffer + count - 8) = distribution(generator);
+namespace {
+	/**
+	 * @returns the high 64 bits of @a a * @a b and stores the low 64 bits
+	 * in @a low
+	 */
+	uint64 multiply(uint64 a, uint64 b, uint64& low) {
+#if defined WINDOWS && defined _M_X64
+		uint64 high;
+		low = _umul128(a, b, &high);
+		return high;
+#elif defined __SIZEOF_INT128__
+		unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+		low = static_cast<uint64>(product);
+		return static_cast<uint64>(product >> 64);
+#else
+		uint64 a_low = a & 0xFFFFFFFF, a_high = a >> 32, b_low = b & 0xFFFFFFFF, b_high = b >> 32;
+		uint64 cross = (a_low * b_low >> 32) + (a_high * b_low & 0xFFFFFFFF) + a_low * b_high;
+		low = a * b;
+		return a_high * b_high + (a_high * b_low >> 32) + (cross >> 32);
+#endif
+	}
+
+	/**
+	 * Maps @a value onto [0, @a range), drawing replacements from the
+	 * generator for the few values that would bias the result.
+	 */
+	uint64 bounded(uint64 value, uint64 range, uint64 threshold) {
+		uint64 low;
+		uint64 result = multiply(value, range, low);
+
+		while (low < threshold)
+			result = multiply(crypto::generator()(), range, low);
+
+		return result;
+	}
+
+	uint64 bounded32(uint32 value, uint64 range, uint64 threshold) {
+		uint64 product = value * range;
 
-		for (; count > 0; count--)
-			*(buffer + count - 1) = static_cast<uint8>(distribution(generator));
+		while ((product & 0xFFFFFFFF) < threshold)
+			product = (crypto::generator()() & 0xFFFFFFFF) * range;
+
+		return product >> 32;
+	}
+
+	float64 unit_interval(uint64 value) {
+		float64 result;
+
+		//Put 52 random bits under the exponent of 1.0 to get [1, 2).
+		value = (value >> 12) | 0x3FF0000000000000ULL;
+		memcpy(&result, &value, sizeof(result));
+
+		return result - 1.0;
+	}
+
+#ifdef X86
+	target_avx2 word bounded32_avx2(uint64* values, const uint8* raw, word count, uint64 floor, uint64 range, uint64 threshold) {
+		const __m256i ranges = _mm256_set1_epi64x(static_cast<int64>(range));
+		const __m256i thresholds = _mm256_set1_epi64x(static_cast<int64>(threshold));
+		const __m256i floors = _mm256_set1_epi64x(static_cast<int64>(floor));
+		const __m256i low_mask = _mm256_set1_epi64x(0xFFFFFFFF);
+		word i = 0;
+
+		for (; i + 4 <= count; i += 4) {
+			__m256i product = _mm256_mul_epu32(_mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + 4 * i))), ranges);
+			__m256i rejected = _mm256_cmpgt_epi64(thresholds, _mm256_and_si256(product, low_mask));
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i), _mm256_add_epi64(_mm256_srli_epi64(product, 32), floors));
+
+			int lanes = _mm256_movemask_pd(_mm256_castsi256_pd(rejected));
+
+			for (word j = 0; lanes != 0; j++, lanes >>= 1)
+				if (lanes & 1)
+					values[i + j] = floor + bounded32(static_cast<uint32>(crypto::generator()()), range, threshold);
+		}
+
+		return i;
+	}
+
+	target_avx2 word unit_interval_avx2(float64* values, word count, float64 floor, float64 width, float64 limit) {
+		const __m256i exponent = _mm256_set1_epi64x(0x3FF0000000000000LL);
+		const __m256d ones = _mm256_set1_pd(1.0), floors = _mm256_set1_pd(floor), widths = _mm256_set1_pd(width), limits = _mm256_set1_pd(limit);
+		word i = 0;
+
+		for (; i + 4 <= count; i += 4) {
+			__m256i bits = _mm256_or_si256(_mm256_srli_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)), 12), exponent);
+			__m256d unit = _mm256_sub_pd(_mm256_castsi256_pd(bits), ones);
+
+			_mm256_storeu_pd(values + i, _mm256_min_pd(_mm256_add_pd(_mm256_mul_pd(unit, widths), floors), limits));
+		}
+
+		return i;
+	}
+#endif
+
+	/**
+	 * Fills @a values with random integers in [@a floor, @a floor + @a
+	 * range), where a @a range of zero means all 2^64 values.
+	 */
+	void fill_uniform(uint64* values, word count, uint64 floor, uint64 range) {
+		uint8* bytes = reinterpret_cast<uint8*>(values);
+		word i = 0;
+
+		if (range == 0 || range > 0xFFFFFFFF) {
+			crypto::random_bytes(bytes, count * 8);
+
+			if (range == 0)
+				return;
+
+			uint64 threshold = (0 - range) % range;
+
+			for (; i < count; i++)
+				values[i] = floor + bounded(values[i], range, threshold);
+
+			return;
+		}
+
+		//Small intervals need only 32 random bits per value, so generate half
+		//as many into the back half of the output and widen them in place.
+		//Value i is written no further than raw value i + 1 starts.
+		uint64 threshold = (0x100000000ULL - range) % range;
+		uint8* raw = bytes + count * 4;
+
+		crypto::random_bytes(raw, count * 4);
+
+#ifdef X86
+		if (cpu::has_avx2())
+			i = bounded32_avx2(values, raw, count, floor, range, threshold);
+#endif
+
+		for (; i < count; i++) {
+			uint32 value;
+			memcpy(&value, raw + 4 * i, sizeof(value));
+
+			values[i] = floor + bounded32(value, range, threshold);
+		}
+	}
+}
+
+void crypto::fill_uniform_int64(span<int64> target, int64 floor, int64 ceiling) {
+	static_assert(sizeof(int64) == sizeof(uint64), "int64 and uint64 must be the same size.");
+
+	fill_uniform(reinterpret_cast<uint64*>(target.data()), target.size(), static_cast<uint64>(floor), static_cast<uint64>(ceiling) - static_cast<uint64>(floor) + 1);
+}
+
+void crypto::fill_uniform_uint64(span<uint64> target, uint64 floor, uint64 ceiling) {
+	fill_uniform(target.data(), target.size(), floor, ceiling - floor + 1);
+}
+
+void crypto::fill_uniform_float64(span<float64> target, float64 floor, float64 ceiling) {
+	static_assert(sizeof(float64) == sizeof(uint64), "float64 must be 64 bits.");
+
+	float64* values = target.data();
+	float64 width = ceiling - floor;
+	word i = 0;
+
+	//floor + unit * width can round up to ceiling, so clamp to the largest value below it.
+	float64 limit = ceiling > floor ? nextafter(ceiling, floor) : floor;
+
+	crypto::random_bytes(reinterpret_cast<uint8*>(values), target.size() * static_cast<word>(sizeof(float64)));
+
+#ifdef X86
+	if (cpu::has_avx2())
+		i = unit_interval_avx2(values, target.size(), floor, width, limit);
+#endif
+
+	for (; i < target.size(); i++) {
+		uint64 bits;
+		memcpy(&bits, values + i, sizeof(bits));
+
+		values[i] = min(floor + unit_interval(bits) * width, limit);
 	}
 }
 
 int64 crypto::random_int64(int64 floor, int64 ceiling) {
-	return uniform_int_distribution<int64>(floor, ceiling)(generator);
+	int64 result;
+
+	crypto::fill_uniform_int64(span<int64>(&result, 1), floor, ceiling);
+
+	return result;
 }
 
 uint64 crypto::random_uint64(uint64 floor, uint64 ceiling) {
-	return uniform_int_distribution<uint64>(floor, ceiling)(generator);
-}
+	uint64 result;
 
+	crypto::fill_uniform_uint64(span<uint64>(&result, 1), floor, ceiling);
+
+	return result;
+}
 
 float64 crypto::random_float64(float64 floor, float64 ceiling) {
-	return uniform_real_distribution<float64>(floor, ceiling)(generator);
+	float64 result;
+
+	crypto::fill_uniform_float64(span<float64>(&result, 1), floor, ceiling);
+
+	return result;
 }
@@ -4,8 +4,12 @@
 #include <array>
 
 #include "Common.h"
+#include "View.h"
 
 namespace util {
+	class data_stream;
+	class segmented_stream;
+
 	/**
 	 * Cryptographic utilities
 	 */
@@ -13,8 +17,129 @@ namespace util {
 		static const word sha2_length = 64;
 		static const word sha1_length = 20;
 
-		extern std::random_device device;
-		extern std::mt19937_64 generator;
+		/**
+		 * Digests the hasher can compute. sha2 is SHA2-512, as in
+		 * calculate_sha2.
+		 */
+		enum class hash_algorithm {
+			sha1,
+			sha2
+		};
+
+		/**
+		 * Incremental hash over any number of buffers, so chained or
+		 * segmented data can be hashed without joining it first. Call
+		 * update as many times as needed, then final. Call reset before
+		 * hashing the next message with the same hasher.
+		 */
+		class hasher {
+			struct context;
+
+			context* state;
+			hash_algorithm algorithm;
+
+			public:
+				explicit hasher(hash_algorithm algorithm);
+				hasher(hasher&& other);
+				~hasher();
+
+				hasher& operator=(hasher&& other);
+
+				hasher(const hasher& other) = delete;
+				hasher& operator=(const hasher& other) = delete;
+
+				/**
+				 * @returns the number of bytes final writes
+				 */
+				word length() const;
+
+				/**
+				 * Hashes @a length bytes from @a source
+				 */
+				void update(const uint8* source, word length);
+
+				/**
+				 * Hashes everything written to @a stream
+				 */
+				void update(const data_stream& stream);
+
+				/**
+				 * Hashes every segment of @a stream in order
+				 */
+				void update(const segmented_stream& stream);
+
+				/**
+				 * Writes the digest of everything hashed since construction or
+				 * the last reset to @a result, which must hold length() bytes
+				 */
+				void final(uint8* result);
+
+				/**
+				 * Discards everything hashed so far
+				 */
+				void reset();
+		};
+
+		/**
+		 * Cryptographically secure generator built on the ChaCha20 block
+		 * function and usable with the standard distributions. Output is
+		 * produced buffer_size bytes at a time using fast key erasure: the
+		 * first 32 bytes of every batch replace the key and are never
+		 * returned, so earlier output can't be recovered from the state.
+		 * The key is seeded from std::random_device and mixed with fresh
+		 * entropy every reseed_interval bytes and after a fork.
+		 *
+		 * Not thread safe; use generator() for this thread's instance.
+		 */
+		class chacha20_generator {
+			public:
+				typedef uint64 result_type;
+
+				static const word key_size = 32;
+				static const word block_size = 64;
+				static const word buffer_size = 16 * block_size;
+				static const uint64 reseed_interval = 1024 * 1024;
+
+				chacha20_generator();
+
+				chacha20_generator(const chacha20_generator& other) = delete;
+				chacha20_generator& operator=(const chacha20_generator& other) = delete;
+
+				static constexpr result_type min() {
+					return 0;
+				}
+
+				static constexpr result_type max() {
+					return ~static_cast<result_type>(0);
+				}
+
+				result_type operator()();
+
+				/**
+				 * Writes @a count random bytes to @a buffer
+				 */
+				void generate(uint8* buffer, word count);
+
+				/**
+				 * Mixes fresh entropy from std::random_device into the key
+				 * and discards any buffered output
+				 */
+				void reseed();
+
+			private:
+				uint32 key[key_size / 4];
+				uint8 buffer[buffer_size];
+				word available;
+				uint64 until_reseed;
+				uint64 generation;
+
+				void refill();
+		};
+
+		/**
+		 * @returns the calling thread's generator, created on first use
+		 */
+		chacha20_generator& generator();
 
 		/**
 		 * Take SHA2-512 of @a length bytes from @a source
@@ -45,8 +170,29 @@ namespace util {
 
 		/**
 		 * @returns a random 64-bit floating point number in the interval of [@a floor, @a
-		 * ceiling]
+		 * ceiling)
 		 */
 		float64 random_float64(float64 floor, float64 ceiling);
+
+		/**
+		 * Fills @a target with random integers in the interval of [@a floor,
+		 * @a ceiling]. The random bits for the whole span are generated at
+		 * once and mapped onto the interval without bias using Lemire's
+		 * multiply-and-reject method. Intervals of fewer than 2^32 values
+		 * use 32 random bits per value and are vectorized; wider ones use
+		 * 64 bits per value and are not.
+		 */
+		void fill_uniform_int64(span<int64> target, int64 floor, int64 ceiling);
+
+		/**
+		 * Unsigned version of fill_uniform_int64
+		 */
+		void fill_uniform_uint64(span<uint64> target, uint64 floor, uint64 ceiling);
+
+		/**
+		 * Fills @a target with random floating point numbers in the interval
+		 * of [@a floor, @a ceiling), each with 52 random bits of mantissa
+		 */
+		void fill_uniform_float64(span<float64> target, float64 floor, float64 ceiling);
 	}
 }
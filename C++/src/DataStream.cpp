@@ -1,42 +1,92 @@
 #include "DataStream.h"
 
 #include <cstring>
+#include <atomic>
 
 #include "Misc.h"
 
 using namespace std;
 using namespace util;
 
-data_stream::data_stream() {
+struct data_stream::shared_buffer {
+	atomic<word> references;
+	uint8* data;
+	word allocation;
+	buffer_pool* pool;
+	bool pooled;
+	unique_ptr<mapped_file> mapping;
+
+	shared_buffer(uint8* data, word allocation, buffer_pool* pool, bool pooled) : references(1), data(data), allocation(allocation), pool(pool), pooled(pooled) {
+
+	}
+
+	shared_buffer(mapped_file&& file) : shared_buffer(file.data(), file.size(), nullptr, false) {
+		this->mapping.reset(new mapped_file(move(file)));
+	}
+};
+
+data_stream::data_stream() : data_stream(buffer_pool::shared()) {
+
+}
+
+data_stream::data_stream(buffer_pool& pool) {
 	this->cursor = 0;
 	this->written = 0;
-	this->allocation = data_stream::minimum_size;
-	this->buffer = new uint8[data_stream::minimum_size];
+	this->allocation = data_stream::inline_size;
+	this->buffer = this->local;
+	this->pool = &pool;
+	this->pooled = false;
+	this->shared = nullptr;
+	this->prefix = string_prefix::fixed16;
 }
 
-data_stream::data_stream(uint8* data, word length) {
-	this->cursor = 0;
+data_stream::data_stream(uint8* data, word length) : data_stream() {
 	this->written = length;
 	this->allocation = length;
 	this->buffer = data;
 }
 
-data_stream::data_stream(const uint8* data, word length) {
-	this->cursor = 0;
+data_stream::data_stream(uint8* data, word length, buffer_pool& pool) : data_stream(pool) {
 	this->written = length;
-	this->allocation = length;
-	this->buffer = new uint8[length];
+
+	if (length > data_stream::inline_size) {
+		this->allocation = data_stream::allocation_for(length);
+		this->buffer = data;
+		this->pooled = true;
+	}
+	else {
+		memcpy(this->local, data, length);
+		pool.release(data, data_stream::allocation_for(length));
+	}
+}
+
+data_stream::data_stream(mapped_file&& file) : data_stream() {
+	if (file.size() == 0)
+		return;
+
+	this->shared = new shared_buffer(move(file));
+	this->buffer = this->shared->data;
+	this->allocation = this->shared->allocation;
+	this->written = this->shared->allocation;
+}
+
+data_stream::data_stream(const uint8* data, word length) : data_stream() {
+	this->written = length;
+
+	if (length > data_stream::inline_size) {
+		this->allocation = data_stream::allocation_for(length);
+		this->buffer = this->pool->allocate(this->allocation);
+		this->pooled = true;
+	}
 
 	memcpy(this->buffer, data, length);
 }
 
-data_stream::data_stream(data_stream&& other) {
-	this->buffer = nullptr;
+data_stream::data_stream(data_stream&& other) : data_stream() {
 	*this = move(other);
 }
 
-data_stream::data_stream(const data_stream& other) {
-	this->buffer = nullptr;
+data_stream::data_stream(const data_stream& other) : data_stream() {
 	*this = other;
 }
 
@@ -44,41 +94,128 @@ data_stream::~data_stream() {
 	this->cursor = 0;
 	this->written = 0;
 
-	if (this->buffer)
+	this->release();
+}
+
+void data_stream::release() {
+	if (this->shared) {
+		if (this->shared->references.fetch_sub(1, memory_order_acq_rel) == 1) {
+			if (this->shared->pooled)
+				this->shared->pool->release(this->shared->data, this->shared->allocation);
+			else if (!this->shared->mapping)
+				delete[] this->shared->data;
+
+			delete this->shared;
+		}
+	}
+	else if (this->pooled) {
+		this->pool->release(this->buffer, this->allocation);
+	}
+	else if (this->buffer != this->local) {
 		delete[] this->buffer;
+	}
+
+	this->allocation = data_stream::inline_size;
+	this->buffer = this->local;
+	this->pooled = false;
+	this->shared = nullptr;
+}
+
+bool data_stream::shares_buffer() const {
+	if (!this->shared)
+		return false;
+
+	if (this->shared->mapping && !this->shared->mapping->writable())
+		return true;
+
+	return this->shared->references.load(memory_order_acquire) > 1;
+}
+
+word data_stream::allocation_for(word size) {
+	word allocation = data_stream::inline_size;
+
+	while (allocation < size)
+		allocation *= data_stream::growth;
+
+	return allocation;
+}
+
+data_stream data_stream::share() {
+	if (this->buffer != this->local && !this->shared) {
+		this->shared = new shared_buffer(this->buffer, this->allocation, this->pool, this->pooled);
+		this->pooled = false;
+	}
+
+	return *this;
 }
 
 data_stream& data_stream::operator=(data_stream&& other) {
-	if (this->buffer)
-		delete[] this->buffer;
+	if (this == &other)
+		return *this;
+
+	this->release();
 
 	this->cursor = other.cursor;
 	this->written = other.written;
-	this->allocation = other.allocation;
-	this->buffer = other.buffer;
+	this->pool = other.pool;
+	this->prefix = other.prefix;
+
+	if (other.buffer == other.local) {
+		memcpy(this->local, other.local, other.written);
+	}
+	else {
+		this->allocation = other.allocation;
+		this->buffer = other.buffer;
+		this->pooled = other.pooled;
+		this->shared = other.shared;
+	}
 
 	other.cursor = 0;
 	other.written = 0;
-	other.allocation = 0;
-	other.buffer = nullptr;
+	other.allocation = data_stream::inline_size;
+	other.buffer = other.local;
+	other.pooled = false;
+	other.shared = nullptr;
 
 	return *this;
 }
 
 data_stream& data_stream::operator=(const data_stream& other) {
-	if (this->buffer)
-		delete[] this->buffer;
+	if (this == &other)
+		return *this;
+
+	this->release();
 
-	this->allocation = other.allocation;
 	this->cursor = other.cursor;
 	this->written = other.written;
-	this->buffer = new uint8[this->allocation];
+	this->pool = other.pool;
+	this->prefix = other.prefix;
+
+	if (other.shared) {
+		other.shared->references.fetch_add(1, memory_order_relaxed);
+
+		this->shared = other.shared;
+		this->buffer = other.buffer;
+		this->allocation = other.allocation;
+
+		return *this;
+	}
+
+	if (other.written > data_stream::inline_size) {
+		this->allocation = data_stream::allocation_for(other.written);
+		this->buffer = this->pool->allocate(this->allocation);
+		this->pooled = true;
+	}
 
-	memcpy(this->buffer, other.buffer, other.allocation);
+	memcpy(this->buffer, other.buffer, other.written);
 
 	return *this;
 }
 
+void data_stream::set_string_prefix(string_prefix prefix) {
+	this->prefix = prefix;
+}
+
 const uint8* data_stream::data() const {
 	return this->buffer;
 }
@@ -96,20 +233,23 @@ word data_stream::position() const {
 }
 
 void data_stream::resize(word size) {
-	word new_allocation = data_stream::minimum_size;
-
-	while (new_allocation < size)
-		new_allocation *= data_stream::growth;
+	//A writable mapping is used in place for as long as it's big enough; its
+	//allocation is the file size and must never be rounded.
+	bool in_place = this->shared && this->shared->mapping && size <= this->allocation && !this->shares_buffer();
+	word new_allocation = in_place ? this->allocation : data_stream::allocation_for(size);
 
-	if (new_allocation != this->allocation) {
-		uint8* new_buffer = new uint8[new_allocation];
+	if (new_allocation != this->allocation || this->shares_buffer()) {
+		uint8* new_buffer = new_allocation == data_stream::inline_size ? this->local : this->pool->allocate(new_allocation);
 
-		memcpy(new_buffer, this->buffer, size > this->allocation ? this->allocation : size);
+		if (new_buffer != this->buffer) {
+			memcpy(new_buffer, this->buffer, size > this->written ? this->written : size);
 
-		delete[] this->buffer;
+			this->release();
+		}
 
 		this->buffer = new_buffer;
 		this->allocation = new_allocation;
+		this->pooled = new_buffer != this->local;
 
 		if (size < this->cursor)
 			this->cursor = size;
@@ -141,7 +281,7 @@ void data_stream::seek(word position) {
 }
 
 void data_stream::adopt(uint8* buffer, word length) {
-	delete[] this->buffer;
+	this->release();
 
 	this->cursor = 0;
 	this->written = length;
@@ -153,16 +293,24 @@ void data_stream::write(const unique_ptr<uint8[]>& ptr, word count) {
 	this->write(ptr.get(), count);
 }
 
-void data_stream::write(const uint8* data, word count) {
-	if (this->cursor + count >= this->allocation)
-		this->resize(this->cursor + count);
+uint8* data_stream::claim(word count) {
+	word needed = this->cursor + count;
+
+	if (needed > this->allocation || this->shares_buffer())
+		this->resize(needed > this->written ? needed : this->written);
 
-	memcpy(this->buffer + this->cursor, data, count);
+	uint8* claimed = this->buffer + this->cursor;
 
 	this->cursor += count;
 
 	if (this->cursor > this->written)
 		this->written = this->cursor;
+
+	return claimed;
+}
+
+void data_stream::write(const uint8* data, word count) {
+	memcpy(this->claim(count), data, count);
 }
 
 void data_stream::write(const int8* data, word count) {
@@ -172,17 +320,98 @@ void data_stream::write(const int8* data, word count) {
 void data_stream::write(cstr data) {
 	word size = static_cast<word>(strlen(data));
 
-	this->write(size);
+	//C strings have always been prefixed with a whole word, not string_length_type.
+	if (this->prefix == string_prefix::varint)
+		this->write_varint(size);
+	else
+		this->write(size);
+
 	this->write(reinterpret_cast<const uint8*>(data), size);
 }
 
 void data_stream::write(const string& data) {
-	auto size = static_cast<string_length_type>(data.size());
+	word size = static_cast<word>(data.size());
 
-	this->write(size);
+	if (this->prefix == string_prefix::fixed16)
+		size = static_cast<string_length_type>(size);
+
+	this->write_string_length(size);
 	this->write(reinterpret_cast<const uint8*>(data.data()), size);
 }
 
+void data_stream::write_string_length(word length) {
+	if (this->prefix == string_prefix::varint)
+		this->write_varint(length);
+	else
+		this->write(static_cast<string_length_type>(length));
+}
+
+word data_stream::read_string_length() {
+	if (this->prefix == string_prefix::varint)
+		return this->read_varint<word>();
+	else
+		return this->read<string_length_type>();
+}
+
+void data_stream::write_varint_bits(uint64 value) {
+	uint8 bytes[data_stream::max_varint_size];
+	word count = 0;
+
+	while (value >= 0x80) {
+		bytes[count++] = static_cast<uint8>(value | 0x80);
+		value >>= 7;
+	}
+
+	bytes[count++] = static_cast<uint8>(value);
+
+	this->write(bytes, count);
+}
+
+uint64 data_stream::read_varint_bits() {
+	const uint8* position = this->buffer + this->cursor;
+	word available = this->written - this->cursor;
+
+	//Most fields fit in one or two bytes, so decode those without the loop.
+	if (available >= 2) {
+		if (position[0] < 0x80) {
+			this->cursor += 1;
+			return position[0];
+		}
+
+		if (position[1] < 0x80) {
+			if (position[1] == 0)
+				throw invalid_varint();
+
+			this->cursor += 2;
+			return (position[0] & 0x7F) | (static_cast<uint64>(position[1]) << 7);
+		}
+	}
+
+	word limit = available < data_stream::max_varint_size ? available : data_stream::max_varint_size;
+	uint64 result = 0;
+
+	for (word i = 0; i < limit; i++) {
+		uint64 byte = position[i];
+
+		result |= (byte & 0x7F) << (7 * i);
+
+		if (byte < 0x80) {
+			//A zero final byte means the value had a shorter encoding.
+			if ((i != 0 && byte == 0) || (i == data_stream::max_varint_size - 1 && byte > 1))
+				throw invalid_varint();
+
+			this->cursor += i + 1;
+
+			return result;
+		}
+	}
+
+	if (limit == data_stream::max_varint_size)
+		throw invalid_varint();
+
+	throw read_past_end_exception();
+}
+
 void data_stream::write(const data_stream& data) {
 	this->write(data.data(), data.size());
 }
@@ -209,8 +438,12 @@ const uint8* data_stream::read(word count) {
 	return this->buffer + this->cursor - count;
 }
 
+data_stream::reader data_stream::read_region(word count) {
+	return reader(this->read(count), count);
+}
+
 string data_stream::read_string() {
-	auto length = this->read<string_length_type>();
+	word length = this->read_string_length();
 
 	return string(reinterpret_cast<cstr>(this->read(length)), length);
 }
@@ -218,12 +451,31 @@ string data_stream::read_string() {
 string data_stream::read_utf8() {
 	string result = this->read_string();
 
-	if (misc::is_string_utf8(result))
+	if (!misc::is_string_utf8(result))
 		throw string_not_utf8();
 
 	return result;
 }
 
+string_view data_stream::read_string_view() {
+	word length = this->read_string_length();
+
+	return string_view(reinterpret_cast<cstr>(this->read(length)), length);
+}
+
+string_view data_stream::read_utf8_view() {
+	string_view result = this->read_string_view();
+
+	if (!misc::is_string_utf8(reinterpret_cast<const uint8*>(result.data()), result.size()))
+		throw string_not_utf8();
+
+	return result;
+}
+
+span<const uint8> data_stream::read_span(word count) {
+	return span<const uint8>(this->read(count), count);
+}
+
 date_time data_stream::read_date_time() {
 	return util::from_epoch(this->read<uint64>());
 }
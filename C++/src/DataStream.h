@@ -1,28 +1,98 @@
 #pragma once
 
 #include <string>
+#include <cstring>
 #include <type_traits>
+#include <limits>
 #include <memory>
 
 #include "Common.h"
+#include "BufferPool.h"
+#include "ByteOrder.h"
+#include "MappedFile.h"
+#include "View.h"
 
 namespace util {
+	/**
+	* How data_stream prefixes strings with their length.
+	*/
+	enum class string_prefix {
+		fixed16,
+		varint
+	};
+
 	/**
 	* Seekable stream access to a buffer. Offers more safety than
 	* util::Array by disallowing reading past the end of what has been
 	* written.
 	*
 	* Additionally, includes length-prefixed string parsing.
+	*
+	* Streams of up to inline_size bytes are stored inside the stream
+	* itself and only move to a buffer from their buffer_pool once they
+	* grow past that.
+	*
+	* Larger buffers can be shared between copies with share(). A stream
+	* sharing its buffer copies it the first time it is written to.
+	*
+	* A stream can also be opened over a mapped_file and parsed in place.
+	* Copies share the mapping. A read-only mapping is copied out the first
+	* time the stream is written to, as is a writable one that grows past
+	* the end of the file.
 	*/
 	class data_stream {
-		word allocation;
-		word cursor;
-		word written;
-		uint8* buffer;
+		public:
+			static const word inline_size = 64;
+			static const word max_varint_size = 10;
+
+		private:
+			word allocation;
+			word cursor;
+			word written;
+			uint8* buffer;
+			uint8 local[inline_size];
+			buffer_pool* pool;
+			bool pooled;
+
+			struct shared_buffer;
+			shared_buffer* shared;
+
+			string_prefix prefix;
+
+			static const word growth = 2;
+			typedef uint16 string_length_type;
+
+			void release();
+			bool shares_buffer() const;
+
+			void write_varint_bits(uint64 value);
+			uint64 read_varint_bits();
+			void write_string_length(word length);
+			word read_string_length();
+
+			template<typename T> static uint64 zigzag(T value, std::true_type) {
+				return (static_cast<uint64>(value) << 1) ^ static_cast<uint64>(static_cast<int64>(value) >> 63);
+			}
+
+			template<typename T> static uint64 zigzag(T value, std::false_type) {
+				return static_cast<uint64>(value);
+			}
+
+			template<typename T> static T unzigzag(uint64 bits, std::true_type) {
+				int64 value = static_cast<int64>((bits >> 1) ^ (~(bits & 1) + 1));
+
+				if (value < static_cast<int64>(std::numeric_limits<T>::min()) || value > static_cast<int64>(std::numeric_limits<T>::max()))
+					throw invalid_varint();
+
+				return static_cast<T>(value);
+			}
+
+			template<typename T> static T unzigzag(uint64 bits, std::false_type) {
+				if (bits > static_cast<uint64>(std::numeric_limits<T>::max()))
+					throw invalid_varint();
 
-		static const word minimum_size = 32;
-		static const word growth = 2;
-		typedef uint16 string_length_type;
+				return static_cast<T>(bits);
+			}
 
 		public:
 			/**
@@ -37,8 +107,92 @@ namespace util {
 
 			class invalid_size {};
 
+			/**
+			* Thrown when a varint is longer than ten bytes, is not in its
+			* shortest encoding, or does not fit the type it is read as.
+			*/
+			class invalid_varint {};
+
+			/**
+			* Sequential view over a region of a stream whose bounds were
+			* checked when it was created, so reads from it are not checked
+			* again. Reading past remaining() is undefined.
+			*/
+			class reader {
+				const uint8* position;
+				const uint8* end;
+
+				public:
+					reader(const uint8* data, word length) : position(data), end(data + length) {
+
+					}
+
+					/**
+					* @returns the number of bytes left in the region
+					*/
+					word remaining() const {
+						return static_cast<word>(this->end - this->position);
+					}
+
+					/**
+					* Returns @a count bytes and advances past them.
+					*/
+					const uint8* read(word count) {
+						const uint8* result = this->position;
+						this->position += count;
+						return result;
+					}
+
+					void skip(word count) {
+						this->position += count;
+					}
+
+					template<typename T> T read() {
+						static_assert(std::is_arithmetic<T>::value, "data_stream::reader::read<T> must be an arithmetic type.");
+						T value;
+						std::memcpy(&value, this->position, sizeof(T));
+						this->position += sizeof(T);
+						return value;
+					}
+
+					template<typename T> reader& operator>>(T& rhs) {
+						rhs = this->read<T>();
+						return *this;
+					}
+			};
+
+			/**
+			* @returns the size of the buffer a stream allocates to hold
+			* @a size bytes
+			*/
+			static word allocation_for(word size);
+
 			data_stream();
+
+			/**
+			* Creates an empty stream that takes its heap buffers from
+			* @a pool. @a pool must outlive the stream.
+			*/
+			explicit data_stream(buffer_pool& pool);
+
+			/**
+			* Takes ownership of @a data, which must have been allocated
+			* with new[].
+			*/
 			data_stream(uint8* data, word length);
+
+			/**
+			* Takes ownership of @a data, which must have been allocated
+			* from @a pool with allocation_for(@a length) bytes.
+			*/
+			data_stream(uint8* data, word length, buffer_pool& pool);
+
+			/**
+			* Creates a stream over the whole of @a file, considering it
+			* initialized, and keeps the mapping alive as long as the stream
+			* or a copy of it uses it.
+			*/
+			explicit data_stream(mapped_file&& file);
 			data_stream(const uint8* data, word length);
 			data_stream(data_stream&& other);
 			data_stream(const data_stream& other);
@@ -49,6 +203,20 @@ namespace util {
 
 			void resize(word size);
 
+			/**
+			* @returns a copy of the stream that shares its buffer instead of
+			* copying it. Copies of the result share the buffer too, so
+			* handing one payload to many recipients costs no copies until
+			* one of them writes. Small inline streams are copied.
+			*/
+			data_stream share();
+
+			/**
+			* Selects how strings written to and read from the stream are
+			* prefixed with their length. Defaults to string_prefix::fixed16.
+			*/
+			void set_string_prefix(string_prefix prefix);
+
 			void shrink_written(word size);
 
 			/**
@@ -88,6 +256,15 @@ namespace util {
 			*/
 			void adopt(uint8* buffer, word length);
 
+			/**
+			* Makes room for @a count bytes at the cursor, considers them
+			* written, and advances the cursor past them.
+			*
+			* @returns pointer to the claimed bytes, which the caller must
+			* fill in. It is invalidated by the next write.
+			*/
+			uint8* claim(word count);
+
 			void write(const std::unique_ptr<uint8[]>& ptr, word count);
 
 			/**
@@ -104,7 +281,8 @@ namespace util {
 
 			/**
 			* Write the C style string @data as bytes to the current location in
-			* the stream, reallocating a larger buffer if need be
+			* the stream, reallocating a larger buffer if need be. The length is
+			* prefixed as a word, or as a varint with string_prefix::varint.
 			*/
 			void write(cstr data);
 
@@ -134,18 +312,48 @@ namespace util {
 			const uint8* read(word count);
 
 			/**
-			* Read a string from the stream. A string is considered two
-			* bytes, the length, followed by that many bytes of data.
+			* Checks once that @a count bytes are available at the cursor and
+			* advances the cursor past them.
+			*
+			* @returns a reader over those bytes
+			*/
+			reader read_region(word count);
+
+			/**
+			* Read a string from the stream. A string is considered its
+			* length, two bytes or a varint depending on the string prefix,
+			* followed by that many bytes of data.
 			*/
 			std::string read_string();
 
 			/**
-			* Read a string from the stream. A string is considered two
-			* bytes, the length, followed by that many bytes of data.
+			* Read a string from the stream. A string is considered its
+			* length, two bytes or a varint depending on the string prefix,
+			* followed by that many bytes of data.
 			* Makes sure that the read data is avlid utf-8.
 			*/
 			std::string read_utf8();
 
+			/**
+			* Like read_string, but returns a view of the string inside the
+			* stream's buffer instead of a copy. The view is valid until the
+			* stream is next written to, resized, reassigned or destroyed.
+			*/
+			string_view read_string_view();
+
+			/**
+			* Like read_utf8, but returns a view of the string inside the
+			* stream's buffer instead of a copy, with the same lifetime as
+			* read_string_view.
+			*/
+			string_view read_utf8_view();
+
+			/**
+			* Returns a view of the next @a count bytes and advances past
+			* them, with the same lifetime as read_string_view.
+			*/
+			span<const uint8> read_span(word count);
+
 			/**
 			* Read a DateTime from the stream. Considered a uint64 of milliseconds.
 			*/
@@ -172,6 +380,40 @@ namespace util {
 				return *reinterpret_cast<const T*>(this->read(sizeof(T)));
 			}
 
+			/**
+			* Write the @a count values at @a data in byte order @a order.
+			*/
+			template<typename T> void write_array(const T* data, word count, endianness order = endianness::native) {
+				static_assert(std::is_arithmetic<T>::value, "data_stream::write_array<T> must be an arithmetic type.");
+				byte_order::copy(this->claim(count * sizeof(T)), reinterpret_cast<const uint8*>(data), count, sizeof(T), order);
+			}
+
+			/**
+			* Read @a count values stored in byte order @a order into @a data.
+			*/
+			template<typename T> void read_array(T* data, word count, endianness order = endianness::native) {
+				static_assert(std::is_arithmetic<T>::value, "data_stream::read_array<T> must be an arithmetic type.");
+				byte_order::copy(reinterpret_cast<uint8*>(data), this->read(count * sizeof(T)), count, sizeof(T), order);
+			}
+
+			/**
+			* Write @a data as a LEB128 varint, taking one byte per seven
+			* significant bits. Signed values are zigzag encoded first so
+			* that small negative numbers stay short.
+			*/
+			template<typename T> void write_varint(T data) {
+				static_assert(std::is_integral<T>::value, "data_stream::write_varint<T> must be an integral type.");
+				this->write_varint_bits(data_stream::zigzag(data, std::is_signed<T>()));
+			}
+
+			/**
+			* Read a varint written by write_varint<T>.
+			*/
+			template<typename T> T read_varint() {
+				static_assert(std::is_integral<T>::value, "data_stream::read_varint<T> must be an integral type.");
+				return data_stream::unzigzag<T>(this->read_varint_bits(), std::is_signed<T>());
+			}
+
 			template<typename T> data_stream& operator<<(T rhs) {
 				static_assert(std::is_arithmetic<T>::value, "data_stream::operator<< of T must be an arithmetic type.");
 				this->write<T>(rhs);
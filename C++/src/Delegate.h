@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include "Common.h"
+
+namespace util {
+	template<typename Signature> class delegate;
+
+	/**
+	* Copyable callable wrapper like std::function that stores lambdas, function
+	* pointers and object/member function pairs of up to inline_size bytes
+	* inside the delegate itself instead of on the heap. Larger callables are
+	* still accepted but are heap allocated. Calling a delegate is a single
+	* indirect call.
+	*/
+	template<typename R, typename... A> class delegate<R(A...)> {
+	public:
+		static const word inline_size = 4 * sizeof(void*);
+
+	private:
+		typedef typename std::aligned_storage<inline_size, alignof(std::max_align_t)>::type storage_type;
+
+		struct manager {
+			void (*copy)(const storage_type& source, storage_type& target);
+			void (*move)(storage_type& source, storage_type& target);
+			void (*destroy)(storage_type& target);
+		};
+
+		template<typename F> struct stored {
+			static const bool is_inline = sizeof(F) <= sizeof(storage_type) && alignof(F) <= alignof(storage_type) && std::is_nothrow_move_constructible<F>::value;
+
+			typedef std::integral_constant<bool, is_inline> placement;
+
+			static const manager operations;
+
+			static F* get(storage_type& storage, std::true_type) {
+				return reinterpret_cast<F*>(&storage);
+			}
+
+			static F* get(storage_type& storage, std::false_type) {
+				return *reinterpret_cast<F**>(&storage);
+			}
+
+			static F* get(storage_type& storage) {
+				return stored::get(storage, placement());
+			}
+
+			template<typename G> static void create(storage_type& storage, G&& callable, std::true_type) {
+				new (&storage) F(std::forward<G>(callable));
+			}
+
+			template<typename G> static void create(storage_type& storage, G&& callable, std::false_type) {
+				new (&storage) F*(new F(std::forward<G>(callable)));
+			}
+
+			template<typename G> static void create(storage_type& storage, G&& callable) {
+				stored::create(storage, std::forward<G>(callable), placement());
+			}
+
+			static R invoke(storage_type& storage, A&&... arguments) {
+				return static_cast<R>((*stored::get(storage))(std::forward<A>(arguments)...));
+			}
+
+			static void copy(const storage_type& source, storage_type& target) {
+				stored::create(target, *stored::get(const_cast<storage_type&>(source)));
+			}
+
+			static void move(storage_type& source, storage_type& target, std::true_type) {
+				F* callable = stored::get(source);
+
+				stored::create(target, std::move(*callable));
+				callable->~F();
+			}
+
+			static void move(storage_type& source, storage_type& target, std::false_type) {
+				new (&target) F*(stored::get(source));
+			}
+
+			static void move(storage_type& source, storage_type& target) {
+				stored::move(source, target, placement());
+			}
+
+			static void destroy(storage_type& target, std::true_type) {
+				stored::get(target)->~F();
+			}
+
+			static void destroy(storage_type& target, std::false_type) {
+				delete stored::get(target);
+			}
+
+			static void destroy(storage_type& target) {
+				stored::destroy(target, placement());
+			}
+		};
+
+		mutable storage_type storage;
+		R (*invoker)(storage_type&, A&&...);
+		const manager* operations;
+
+		template<typename F> void assign(F&& callable) {
+			typedef typename std::decay<F>::type callable_type;
+
+			stored<callable_type>::create(this->storage, std::forward<F>(callable));
+
+			this->invoker = &stored<callable_type>::invoke;
+			this->operations = &stored<callable_type>::operations;
+		}
+
+		void reset() {
+			if (this->operations)
+				this->operations->destroy(this->storage);
+
+			this->invoker = nullptr;
+			this->operations = nullptr;
+		}
+
+	public:
+		delegate() : invoker(nullptr), operations(nullptr) {
+
+		}
+
+		delegate(std::nullptr_t) : delegate() {
+
+		}
+
+		template<typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, delegate>::value>::type> delegate(F&& callable) : delegate() {
+			this->assign(std::forward<F>(callable));
+		}
+
+		/**
+		* Binds @a method to @a object. The pair is always stored inline.
+		*/
+		template<typename C, typename M> delegate(C* object, M C::* method) : delegate() {
+			this->assign([object, method](A... arguments) -> R {
+				return static_cast<R>((object->*method)(std::forward<A>(arguments)...));
+			});
+		}
+
+		delegate(const delegate& other) : delegate() {
+			*this = other;
+		}
+
+		delegate(delegate&& other) : delegate() {
+			*this = std::move(other);
+		}
+
+		~delegate() {
+			this->reset();
+		}
+
+		delegate& operator=(const delegate& other) {
+			if (this == &other)
+				return *this;
+
+			this->reset();
+
+			if (other.operations) {
+				other.operations->copy(other.storage, this->storage);
+
+				this->invoker = other.invoker;
+				this->operations = other.operations;
+			}
+
+			return *this;
+		}
+
+		delegate& operator=(delegate&& other) {
+			if (this == &other)
+				return *this;
+
+			this->reset();
+
+			if (other.operations) {
+				other.operations->move(other.storage, this->storage);
+
+				this->invoker = other.invoker;
+				this->operations = other.operations;
+				other.invoker = nullptr;
+				other.operations = nullptr;
+			}
+
+			return *this;
+		}
+
+		explicit operator bool() const {
+			return this->invoker != nullptr;
+		}
+
+		R operator()(A... arguments) const {
+			return this->invoker(this->storage, std::forward<A>(arguments)...);
+		}
+	};
+
+	template<typename R, typename... A> template<typename F> const typename delegate<R(A...)>::manager delegate<R(A...)>::stored<F>::operations = {
+		&stored<F>::copy,
+		&stored<F>::move,
+		&stored<F>::destroy
+	};
+}
@@ -2,30 +2,91 @@
 
 #include <vector>
 #include <algorithm>
+#include <memory>
 #include <mutex>
 #include <utility>
 #include <functional>
+#include <atomic>
 
 #include "Common.h"
+#include "Delegate.h"
 
 namespace util {
+	/**
+	* Multicast event. Handlers are kept in an immutable list that is
+	* replaced whenever one is added or removed. Firing registers itself as
+	* a reader, loads the current list and calls it without taking a lock,
+	* so it never waits on other fires or on handlers being changed.
+	* Replaced lists are freed once no fire is reading, either by the next
+	* change or by the last fire to finish. A handler removed while the
+	* event is being fired may still be called by that fire.
+	*/
 	template<typename... U> class event {
 	public:
-		typedef std::function<void(U...)> handler_type;
+		typedef delegate<void(U...)> handler_type;
+		typedef uint64 token_type;
+
+		event() : handlers(nullptr), readers(0), retiring(false), next_token(0) {
+
+		}
+
+		~event() {
+			delete this->handlers.load();
+		}
 
-		event() = default;
 		event(const event& other) = delete;
 		event& operator=(const event& other) = delete;
 
 	private:
-		std::vector<handler_type> handlers;
+		typedef std::vector<std::pair<token_type, handler_type>> handler_list;
+
+		struct reader {
+			event& owner;
+
+			reader(event& owner) : owner(owner) {
+				this->owner.readers.fetch_add(1);
+			}
+
+			~reader() {
+				if (this->owner.readers.fetch_sub(1) != 1 || !this->owner.retiring)
+					return;
+
+				std::unique_lock<std::mutex> lck(this->owner.lock, std::try_to_lock);
+
+				if (lck.owns_lock())
+					this->owner.reclaim();
+			}
+		};
+
+		std::atomic<const handler_list*> handlers;
+		std::atomic<word> readers;
+		std::atomic<bool> retiring;
+		std::vector<std::unique_ptr<const handler_list>> retired;
+		token_type next_token;
 		std::mutex lock;
 
+		//A fire registers as a reader before loading the list, so once there
+		//are no readers no fire can still hold a replaced list. Requires lock.
+		void reclaim() {
+			if (this->readers.load() != 0)
+				return;
+
+			this->retired.clear();
+			this->retiring = false;
+		}
+
+		//Requires lock.
+		void publish(const handler_list* updated) {
+			this->retired.emplace_back(this->handlers.exchange(updated));
+			this->retiring = true;
+			this->reclaim();
+		}
+
 	public:
 		std::function<void()> event_added;
 		std::function<void()> event_removed;
 
-		event(event&& other) {
+		event(event&& other) : event() {
 			*this = std::move(other);
 		}
 
@@ -33,47 +94,102 @@ namespace util {
 			std::unique_lock<std::mutex> lck1(this->lock);
 			std::unique_lock<std::mutex> lck2(other.lock);
 
-			this->handlers = std::move(other.handlers);
+			this->publish(other.handlers.exchange(nullptr));
+			this->next_token = other.next_token;
 
 			return *this;
 		}
 
-		void operator+=(handler_type hndlr) {
+		/**
+		* @returns a token that removes @a hndlr again when passed to -=
+		*/
+		token_type operator+=(handler_type hndlr) {
 			std::unique_lock<std::mutex> lck(this->lock);
 
-			this->handlers.push_back(hndlr);
+			auto current = this->handlers.load();
+			std::unique_ptr<handler_list> updated(current ? new handler_list(*current) : new handler_list());
+			token_type token = ++this->next_token;
+
+			updated->emplace_back(token, std::move(hndlr));
+			this->publish(updated.release());
 
 			if (this->event_added)
 				this->event_added();
+
+			return token;
 		}
 
-		template<typename... V> void operator()(V&&... paras) {
+		/**
+		* Removes the handler that was added with @a token.
+		*
+		* @returns false if no handler has that token
+		*/
+		bool operator-=(token_type token) {
 			std::unique_lock<std::mutex> lck(this->lock);
 
-			for (auto i : this->handlers)
-				i(std::forward<V>(paras)...);
+			auto current = this->handlers.load();
+
+			if (!current)
+				return false;
+
+			auto position = std::find_if(current->begin(), current->end(), [token](const std::pair<token_type, handler_type>& entry) { return entry.first == token; });
+
+			if (position == current->end())
+				return false;
+
+			std::unique_ptr<handler_list> updated(new handler_list());
+			updated->reserve(current->size() - 1);
+			updated->insert(updated->end(), current->begin(), position);
+			updated->insert(updated->end(), position + 1, current->end());
+
+			this->publish(updated.release());
+
+			if (this->event_removed)
+				this->event_removed();
+
+			return true;
+		}
+
+		template<typename... V> void operator()(V&&... paras) {
+			reader guard(*this);
+			auto current = this->handlers.load();
+
+			if (!current)
+				return;
+
+			for (auto& i : *current)
+				i.second(std::forward<V>(paras)...);
 		}
 	};
 
+	/**
+	* Event with at most one handler. The handler is stored inline and
+	* never changes once set, so firing is a flag check and one delegate
+	* call. Only setting it takes a lock.
+	*/
 	template<typename T, typename... U> class event_single {
 	public:
-		typedef std::function<T(U...)> handler_type;
+		typedef delegate<T(U...)> handler_type;
 
 		class event_already_set {};
 
-		event_single() = default;
+		event_single() : set(false) {
+
+		}
+
 		event_single(const event_single& other) = delete;
 		event_single& operator=(const event_single& other) = delete;
 
 	private:
 		handler_type handler;
+		std::atomic<bool> set;
 		std::mutex lock;
 
 	public:
 		std::function<void()> event_added;
 		std::function<void()> event_removed;
 
-		event_single(event_single&& other) {
+		event_single(event_single&& other) : event_single() {
 			*this = std::move(other);
 		}
 
@@ -81,8 +197,9 @@ namespace util {
 			std::unique_lock<std::mutex> lck1(this->lock);
 			std::unique_lock<std::mutex> lck2(other.lock);
 
-			this->handler = other.handler;
-			other.handler = nullptr;
+			this->handler = std::move(other.handler);
+			this->set = other.set.load();
+			other.set = false;
 
 			return *this;
 		}
@@ -90,19 +207,18 @@ namespace util {
 		void operator+=(handler_type func) {
 			std::unique_lock<std::mutex> lck(this->lock);
 
-			if (this->handler)
+			if (this->set)
 				throw event_already_set();
 
-			this->handler = func;
+			this->handler = std::move(func);
+			this->set.store(true, std::memory_order_release);
 
 			if (this->event_added)
 				this->event_added();
 		}
 
 		template<typename... V> T operator()(V&&... paras) {
-			std::unique_lock<std::mutex> lck(this->lock);
-
-			if (this->handler)
+			if (this->set.load(std::memory_order_acquire))
 				return this->handler(std::forward<V>(paras)...);
 			else
 				return T();
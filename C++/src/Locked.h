@@ -1,6 +1,11 @@
 #pragma once
 
 #include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <type_traits>
 
 #include "Common.h"
 
@@ -34,4 +39,138 @@ namespace util {
 			return this->data;
 		}
 	};
-}
\ No newline at end of file
+
+	/**
+	* Like util::locked, but any number of readers may hold the item at
+	* once while writers get exclusive access. Use read() and write() to get
+	* a guard that holds the lock for its lifetime.
+	*/
+	template<typename T> class shared_locked {
+		std::shared_timed_mutex mtx;
+		T* data;
+
+	public:
+		class read_guard {
+			std::shared_lock<std::shared_timed_mutex> lck;
+			const T* data;
+
+		public:
+			read_guard(std::shared_timed_mutex& mtx, const T* data) : lck(mtx), data(data) {
+
+			}
+
+			const T& operator*() const {
+				return *this->data;
+			}
+
+			const T* operator->() const {
+				return this->data;
+			}
+		};
+
+		class write_guard {
+			std::unique_lock<std::shared_timed_mutex> lck;
+			T* data;
+
+		public:
+			write_guard(std::shared_timed_mutex& mtx, T* data) : lck(mtx), data(data) {
+
+			}
+
+			T& operator*() const {
+				return *this->data;
+			}
+
+			T* operator->() const {
+				return this->data;
+			}
+		};
+
+		shared_locked(T* item = nullptr) {
+			this->data = item;
+		}
+
+		read_guard read() {
+			return read_guard(this->mtx, this->data);
+		}
+
+		write_guard write() {
+			return write_guard(this->mtx, this->data);
+		}
+
+		void lock() {
+			this->mtx.lock();
+		}
+
+		void unlock() {
+			this->mtx.unlock();
+		}
+
+		void lock_shared() {
+			this->mtx.lock_shared();
+		}
+
+		void unlock_shared() {
+			this->mtx.unlock_shared();
+		}
+
+		T* get() {
+			return this->data;
+		}
+	};
+
+	/**
+	* Holds a small trivially copyable value that is read far more often
+	* than it is written. Readers never write shared memory: they copy the
+	* value and retry if a writer changed it meanwhile. Writers are
+	* serialized with a mutex.
+	*/
+	template<typename T> class seqlock {
+		static_assert(std::is_trivially_copyable<T>::value, "typename T must be trivially copyable.");
+
+		alignas(64) std::atomic<word> sequence;
+		T data;
+		std::mutex write_lock;
+
+	public:
+		seqlock(const T& value = T()) : sequence(0), data(value) {
+
+		}
+
+		seqlock(const seqlock& other) = delete;
+		seqlock& operator=(const seqlock& other) = delete;
+
+		T load() const {
+			T result;
+			word before;
+
+			for (;;) {
+				before = this->sequence.load(std::memory_order_acquire);
+
+				if (before & 1) {
+					std::this_thread::yield();
+					continue;
+				}
+
+				std::memcpy(&result, &this->data, sizeof(T));
+				std::atomic_thread_fence(std::memory_order_acquire);
+
+				if (this->sequence.load(std::memory_order_relaxed) == before)
+					return result;
+			}
+		}
+
+		void store(const T& value) {
+			std::unique_lock<std::mutex> lck(this->write_lock);
+
+			word current = this->sequence.load(std::memory_order_relaxed);
+
+			this->sequence.store(current + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			std::memcpy(&this->data, &value, sizeof(T));
+
+			this->sequence.store(current + 2, std::memory_order_release);
+		}
+	};
+}
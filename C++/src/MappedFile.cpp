@@ -0,0 +1,174 @@
+#include "MappedFile.h"
+
+#ifdef WINDOWS
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h>
+#elif defined POSIX
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace util;
+
+mapped_file::mapped_file() {
+	this->view = nullptr;
+	this->length = 0;
+	this->writable_view = false;
+
+#ifdef WINDOWS
+	this->file = INVALID_HANDLE_VALUE;
+	this->mapping = nullptr;
+#endif
+}
+
+mapped_file::mapped_file(const string& path, bool writable, access_pattern pattern) : mapped_file() {
+	this->writable_view = writable;
+
+#ifdef WINDOWS
+	DWORD flags = FILE_ATTRIBUTE_NORMAL;
+
+	if (pattern == access_pattern::sequential)
+		flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+	else if (pattern == access_pattern::random)
+		flags |= FILE_FLAG_RANDOM_ACCESS;
+
+	this->file = CreateFileA(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+	if (this->file == INVALID_HANDLE_VALUE)
+		throw could_not_open_exception();
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(this->file, &file_size)) {
+		this->unmap();
+		throw could_not_open_exception();
+	}
+
+	this->length = static_cast<word>(file_size.QuadPart);
+
+	if (this->length == 0)
+		return;
+
+	this->mapping = CreateFileMappingA(this->file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+	if (!this->mapping) {
+		this->unmap();
+		throw could_not_map_exception();
+	}
+
+	this->view = reinterpret_cast<uint8*>(MapViewOfFile(this->mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0));
+	if (!this->view) {
+		this->unmap();
+		throw could_not_map_exception();
+	}
+#elif defined POSIX
+	int descriptor = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+	if (descriptor < 0)
+		throw could_not_open_exception();
+
+	struct stat status;
+	if (::fstat(descriptor, &status) != 0) {
+		::close(descriptor);
+		throw could_not_open_exception();
+	}
+
+	this->length = static_cast<word>(status.st_size);
+
+	if (this->length != 0) {
+		void* address = ::mmap(nullptr, this->length, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, descriptor, 0);
+
+		if (address == MAP_FAILED) {
+			::close(descriptor);
+			throw could_not_map_exception();
+		}
+
+		this->view = reinterpret_cast<uint8*>(address);
+	}
+
+	::close(descriptor);
+
+	this->advise(pattern);
+#endif
+}
+
+mapped_file::mapped_file(mapped_file&& other) : mapped_file() {
+	*this = move(other);
+}
+
+mapped_file::~mapped_file() {
+	this->unmap();
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other) {
+	if (this == &other)
+		return *this;
+
+	this->unmap();
+
+	this->view = other.view;
+	this->length = other.length;
+	this->writable_view = other.writable_view;
+
+	other.view = nullptr;
+	other.length = 0;
+
+#ifdef WINDOWS
+	this->file = other.file;
+	this->mapping = other.mapping;
+
+	other.file = INVALID_HANDLE_VALUE;
+	other.mapping = nullptr;
+#endif
+
+	return *this;
+}
+
+void mapped_file::unmap() {
+#ifdef WINDOWS
+	if (this->view)
+		UnmapViewOfFile(this->view);
+
+	if (this->mapping)
+		CloseHandle(this->mapping);
+
+	if (this->file != INVALID_HANDLE_VALUE)
+		CloseHandle(this->file);
+
+	this->file = INVALID_HANDLE_VALUE;
+	this->mapping = nullptr;
+#elif defined POSIX
+	if (this->view)
+		::munmap(this->view, this->length);
+#endif
+
+	this->view = nullptr;
+	this->length = 0;
+}
+
+void mapped_file::advise(access_pattern pattern) {
+#ifdef POSIX
+	if (!this->view)
+		return;
+
+	int advice = MADV_NORMAL;
+
+	if (pattern == access_pattern::sequential)
+		advice = MADV_SEQUENTIAL;
+	else if (pattern == access_pattern::random)
+		advice = MADV_RANDOM;
+
+	::madvise(this->view, this->length, advice);
+#endif
+}
+
+uint8* mapped_file::data() const {
+	return this->view;
+}
+
+word mapped_file::size() const {
+	return this->length;
+}
+
+bool mapped_file::writable() const {
+	return this->writable_view;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+
+#include "Common.h"
+
+namespace util {
+	/**
+	* How a mapped file is expected to be read, passed to the operating
+	* system as a paging hint.
+	*/
+	enum class access_pattern {
+		normal,
+		sequential,
+		random
+	};
+
+	/**
+	* A file mapped into memory for as long as the object lives. A writable
+	* mapping is shared with the file, so changes are written back to it.
+	*/
+	class mapped_file {
+		uint8* view;
+		word length;
+		bool writable_view;
+
+		#ifdef WINDOWS
+		void* file;
+		void* mapping;
+		#endif
+
+		void unmap();
+
+		public:
+			class could_not_open_exception {};
+			class could_not_map_exception {};
+
+			mapped_file();
+			mapped_file(const std::string& path, bool writable = false, access_pattern pattern = access_pattern::normal);
+			mapped_file(mapped_file&& other);
+			~mapped_file();
+
+			mapped_file& operator=(mapped_file&& other);
+
+			mapped_file(const mapped_file& other) = delete;
+			mapped_file& operator=(const mapped_file& other) = delete;
+
+			/**
+			* Tells the operating system how the mapping will be read from
+			* now on.
+			*/
+			void advise(access_pattern pattern);
+
+			uint8* data() const;
+			word size() const;
+			bool writable() const;
+	};
+}
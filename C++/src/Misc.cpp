@@ -1,61 +1,530 @@
 #include "Misc.h"
 
+#include <cstring>
+
+#include "CPU.h"
+
+#ifdef X86
+	#include <immintrin.h>
+#endif
+
 using namespace std;
 using namespace util;
 
-string misc::base64_encode(const uint8* data, word length) {
-	static cstr characters = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-	static uint8 endTable[] = { 0, 2, 1 };
+namespace {
+	cstr standard_characters = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	cstr url_characters = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
 
-	string result;
-	result.resize(4 * ((length + 2) / 3));
+	cstr characters_for(misc::base64_alphabet alphabet) {
+		return alphabet == misc::base64_alphabet::url ? url_characters : standard_characters;
+	}
 
-	for (word i = 0, j = 0; i < length;) {
-		uint8 a = i < length ? data[i++] : 0;
-		uint8 b = i < length ? data[i++] : 0;
-		uint8 c = i < length ? data[i++] : 0;
-		uint32 triple = (a << 0x10) | (b << 0x08) | c;
+	/**
+	* Maps each byte to its six bit value, or 0xFF if it isn't part of the
+	* alphabet.
+	*/
+	struct base64_values {
+		uint8 values[256];
 
-		result[j++] = characters[(triple >> 3 * 6) & 0x3F];
-		result[j++] = characters[(triple >> 2 * 6) & 0x3F];
-		result[j++] = characters[(triple >> 1 * 6) & 0x3F];
-		result[j++] = characters[(triple >> 0 * 6) & 0x3F];
+		base64_values(cstr characters) {
+			memset(this->values, 0xFF, sizeof(this->values));
+
+			for (word i = 0; i < 64; i++)
+				this->values[static_cast<uint8>(characters[i])] = static_cast<uint8>(i);
+		}
+	};
+
+	const uint8* values_for(misc::base64_alphabet alphabet) {
+		static const base64_values standard(standard_characters), url(url_characters);
+
+		return alphabet == misc::base64_alphabet::url ? url.values : standard.values;
 	}
 
-	for (word i = 0; i < endTable[length % 3]; i++)
-		result[result.size() - 1 - i] = '=';
+#ifdef X86
+	//Muła's encoder: each group of three bytes is spread over four bytes of
+	//six bits, which are then turned into characters by adding an offset
+	//looked up from the range the value falls in.
+	target_ssse3 __m128i encode_block(__m128i input, __m128i offsets) {
+		input = _mm_shuffle_epi8(input, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
 
-	return result;
-}
+		__m128i high = _mm_mulhi_epu16(_mm_and_si128(input, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+		__m128i low = _mm_mullo_epi16(_mm_and_si128(input, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+		__m128i indices = _mm_or_si128(high, low);
 
-bool misc::is_string_utf8(const string& str) {
-	cstr bytes = str.data();
-
-	uint8 needed = 0, current = bytes[0];
-	for (word i = 0; i < str.size(); current = bytes[++i]) {
-		if (needed == 0) {
-			if ((current >> 1) == 126)
-				needed = 5;
-			else if ((current >> 2) == 62)
-				needed = 4;
-			else if ((current >> 3) == 30)
-				needed = 3;
-			else if ((current >> 4) == 14)
-				needed = 2;
-			else if ((current >> 5) == 6)
+		__m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+		range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+
+		return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, range));
+	}
+
+	target_avx2 __m256i encode_block(__m256i input, __m256i offsets) {
+		input = _mm256_shuffle_epi8(input, _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+
+		__m256i high = _mm256_mulhi_epu16(_mm256_and_si256(input, _mm256_set1_epi32(0x0FC0FC00)), _mm256_set1_epi32(0x04000040));
+		__m256i low = _mm256_mullo_epi16(_mm256_and_si256(input, _mm256_set1_epi32(0x003F03F0)), _mm256_set1_epi32(0x01000010));
+		__m256i indices = _mm256_or_si256(high, low);
+
+		__m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+		range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+
+		return _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, range));
+	}
+
+	__m128i encode_offsets(cstr characters) {
+		const char digit = '0' - 52;
+
+		return _mm_setr_epi8('a' - 26, digit, digit, digit, digit, digit, digit, digit, digit, digit, digit, static_cast<char>(characters[62] - 62), static_cast<char>(characters[63] - 63), 'A', 0, 0);
+	}
+
+	target_ssse3 word encode_ssse3(const uint8* data, word length, char* target, cstr characters) {
+		__m128i offsets = encode_offsets(characters);
+		word i = 0, j = 0;
+
+		for (; i + 16 <= length; i += 12, j += 16)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(target + j), encode_block(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), offsets));
+
+		return i;
+	}
+
+	target_avx2 word encode_avx2(const uint8* data, word length, char* target, cstr characters) {
+		__m256i offsets = _mm256_broadcastsi128_si256(encode_offsets(characters));
+		word i = 0, j = 0;
+
+		for (; i + 28 <= length; i += 24, j += 32) {
+			__m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+			__m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 12));
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(target + j), encode_block(_mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1), offsets));
+		}
+
+		return i;
+	}
+
+	//The decoders classify each character by range and stop at the first
+	//block holding anything outside the alphabet, leaving it to the scalar
+	//loop to reject. Blocks are stored whole, so they stop early enough that
+	//the unused tail of each store still lands inside the output.
+	target_ssse3 word decode_ssse3(const uint8* data, word length, uint8* target, cstr characters) {
+		const __m128i char_62 = _mm_set1_epi8(characters[62]), char_63 = _mm_set1_epi8(characters[63]);
+		const __m128i shift_62 = _mm_set1_epi8(static_cast<char>(62 - characters[62])), shift_63 = _mm_set1_epi8(static_cast<char>(63 - characters[63]));
+		word i = 0, j = 0;
+
+		for (; i + 24 <= length; i += 16, j += 12) {
+			__m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+
+			__m128i upper = _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8('A' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), input));
+			__m128i lower = _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), input));
+			__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), input));
+			__m128i is_62 = _mm_cmpeq_epi8(input, char_62), is_63 = _mm_cmpeq_epi8(input, char_63);
+
+			if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, is_62)), is_63)) != 0xFFFF)
+				break;
+
+			__m128i shift = _mm_or_si128(_mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')), _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))), _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+			shift = _mm_or_si128(shift, _mm_or_si128(_mm_and_si128(is_62, shift_62), _mm_and_si128(is_63, shift_63)));
+
+			__m128i values = _mm_add_epi8(input, shift);
+			__m128i merged = _mm_madd_epi16(_mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140)), _mm_set1_epi32(0x00011000));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(target + j), _mm_shuffle_epi8(merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)));
+		}
+
+		return i;
+	}
+
+	target_avx2 word decode_avx2(const uint8* data, word length, uint8* target, cstr characters) {
+		const __m256i char_62 = _mm256_set1_epi8(characters[62]), char_63 = _mm256_set1_epi8(characters[63]);
+		const __m256i shift_62 = _mm256_set1_epi8(static_cast<char>(62 - characters[62])), shift_63 = _mm256_set1_epi8(static_cast<char>(63 - characters[63]));
+		const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+		word i = 0, j = 0;
+
+		for (; i + 48 <= length; i += 32, j += 24) {
+			__m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+
+			__m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(input, _mm256_set1_epi8('A' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), input));
+			__m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(input, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), input));
+			__m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(input, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), input));
+			__m256i is_62 = _mm256_cmpeq_epi8(input, char_62), is_63 = _mm256_cmpeq_epi8(input, char_63);
+
+			if (_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, is_62)), is_63)) != -1)
+				break;
+
+			__m256i shift = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-'A')), _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a'))), _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+			shift = _mm256_or_si256(shift, _mm256_or_si256(_mm256_and_si256(is_62, shift_62), _mm256_and_si256(is_63, shift_63)));
+
+			__m256i values = _mm256_add_epi8(input, shift);
+			__m256i merged = _mm256_madd_epi16(_mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140)), _mm256_set1_epi32(0x00011000));
+			merged = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(merged, pack), _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(target + j), merged);
+		}
+
+		return i;
+	}
+#endif
+
+	/**
+	* Validates @a bytes against RFC 3629: no 5 or 6 byte forms, no overlong
+	* encodings, no surrogates and nothing above U+10FFFF. Runs of ASCII are
+	* skipped eight bytes at a time.
+	*/
+	bool is_utf8_scalar(const uint8* bytes, word length) {
+		word i = 0;
+
+		while (i < length) {
+			if (i + 8 <= length) {
+				uint64 block;
+				memcpy(&block, bytes + i, 8);
+
+				if ((block & 0x8080808080808080ULL) == 0) {
+					i += 8;
+					continue;
+				}
+			}
+
+			uint8 current = bytes[i];
+
+			if (current < 0x80) {
+				i++;
+				continue;
+			}
+
+			uint8 lower = 0x80, upper = 0xBF;
+			word needed;
+
+			if (current >= 0xC2 && current <= 0xDF) {
 				needed = 1;
-			else if ((current >> 7) == 0)
-				;
-			else
+			}
+			else if (current >= 0xE0 && current <= 0xEF) {
+				needed = 2;
+				lower = current == 0xE0 ? 0xA0 : lower;
+				upper = current == 0xED ? 0x9F : upper;
+			}
+			else if (current >= 0xF0 && current <= 0xF4) {
+				needed = 3;
+				lower = current == 0xF0 ? 0x90 : lower;
+				upper = current == 0xF4 ? 0x8F : upper;
+			}
+			else {
 				return false;
-		}
-		else {
-			if ((current >> 6) == 2)
-				needed--;
-			else
+			}
+
+			if (length - i - 1 < needed)
 				return false;
+
+			if (bytes[i + 1] < lower || bytes[i + 1] > upper)
+				return false;
+
+			for (word j = 2; j <= needed; j++)
+				if ((bytes[i + j] & 0xC0) != 0x80)
+					return false;
+
+			i += needed + 1;
 		}
+
+		return true;
+	}
+
+#ifdef X86
+	//Keiser and Lemire's lookup validator: each byte is classified by the high
+	//and low nibbles of the byte before it and the high nibble of itself. An
+	//error bit survives the three lookups only if all of them agree on it.
+	const uint8 too_short = 1 << 0;
+	const uint8 too_long = 1 << 1;
+	const uint8 overlong_3 = 1 << 2;
+	const uint8 too_large = 1 << 3;
+	const uint8 surrogate = 1 << 4;
+	const uint8 overlong_2 = 1 << 5;
+	const uint8 too_large_1000 = 1 << 6;
+	const uint8 overlong_4 = 1 << 6;
+	const uint8 two_continuations = 1 << 7;
+	const uint8 carry = too_short | too_long | two_continuations;
+
+	alignas(16) const uint8 first_high[16] = {
+		too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+		two_continuations, two_continuations, two_continuations, two_continuations,
+		too_short | overlong_2,
+		too_short,
+		too_short | overlong_3 | surrogate,
+		too_short | too_large | too_large_1000 | overlong_4
+	};
+
+	alignas(16) const uint8 first_low[16] = {
+		carry | overlong_3 | overlong_2 | overlong_4,
+		carry | overlong_2,
+		carry,
+		carry,
+		carry | too_large,
+		carry | too_large | too_large_1000,
+		carry | too_large | too_large_1000,
+		carry | too_large | too_large_1000,
+		carry | too_large | too_large_1000,
+		carry | too_large | too_large_1000,
+		carry | too_large | too_large_1000,
+		carry | too_large | too_large_1000,
+		carry | too_large | too_large_1000,
+		carry | too_large | too_large_1000 | surrogate,
+		carry | too_large | too_large_1000,
+		carry | too_large | too_large_1000
+	};
+
+	alignas(16) const uint8 second_high[16] = {
+		too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+		too_long | overlong_2 | two_continuations | overlong_3 | too_large_1000 | overlong_4,
+		too_long | overlong_2 | two_continuations | overlong_3 | too_large,
+		too_long | overlong_2 | two_continuations | surrogate | too_large,
+		too_long | overlong_2 | two_continuations | surrogate | too_large,
+		too_short, too_short, too_short, too_short
+	};
+
+	//Subtracting these leaves a non-zero byte only where a lead byte near the
+	//end of a block still needs continuation bytes from the next block.
+	alignas(32) const uint8 incomplete_tail[32] = {
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1
+	};
+
+	__m128i load_table(const uint8* table) {
+		return _mm_load_si128(reinterpret_cast<const __m128i*>(table));
+	}
+
+	target_ssse3 word validate_ssse3(const uint8* bytes, word length, bool& valid) {
+		const __m128i nibble = _mm_set1_epi8(0x0F);
+		const __m128i table_1h = load_table(first_high), table_1l = load_table(first_low), table_2h = load_table(second_high);
+		const __m128i tail = _mm_load_si128(reinterpret_cast<const __m128i*>(incomplete_tail + 16));
+		__m128i previous = _mm_setzero_si128(), error = _mm_setzero_si128(), incomplete = _mm_setzero_si128();
+		word done = 0;
+
+		for (; done + 16 <= length; done += 16) {
+			__m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + done));
+
+			if (_mm_movemask_epi8(input) != 0) {
+				__m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+				__m128i prev2 = _mm_alignr_epi8(input, previous, 14);
+				__m128i prev3 = _mm_alignr_epi8(input, previous, 13);
+
+				__m128i special = _mm_and_si128(_mm_and_si128(
+					_mm_shuffle_epi8(table_1h, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+					_mm_shuffle_epi8(table_1l, _mm_and_si128(prev1, nibble))),
+					_mm_shuffle_epi8(table_2h, _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+
+				__m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+				__m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+				__m128i must_continue = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(static_cast<char>(0x80)));
+
+				error = _mm_or_si128(error, _mm_xor_si128(must_continue, special));
+				incomplete = _mm_subs_epu8(input, tail);
+			}
+			else {
+				error = _mm_or_si128(error, incomplete);
+				incomplete = _mm_setzero_si128();
+			}
+
+			previous = input;
+		}
+
+		valid = _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+
+		return done;
+	}
+
+	target_avx2 word validate_avx2(const uint8* bytes, word length, bool& valid) {
+		const __m256i nibble = _mm256_set1_epi8(0x0F);
+		const __m256i table_1h = _mm256_broadcastsi128_si256(load_table(first_high));
+		const __m256i table_1l = _mm256_broadcastsi128_si256(load_table(first_low));
+		const __m256i table_2h = _mm256_broadcastsi128_si256(load_table(second_high));
+		const __m256i tail = _mm256_load_si256(reinterpret_cast<const __m256i*>(incomplete_tail));
+		__m256i previous = _mm256_setzero_si256(), error = _mm256_setzero_si256(), incomplete = _mm256_setzero_si256();
+		word done = 0;
+
+		for (; done + 32 <= length; done += 32) {
+			__m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + done));
+
+			if (_mm256_movemask_epi8(input) != 0) {
+				__m256i shifted = _mm256_permute2x128_si256(previous, input, 0x21);
+				__m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+				__m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+				__m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+
+				__m256i special = _mm256_and_si256(_mm256_and_si256(
+					_mm256_shuffle_epi8(table_1h, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+					_mm256_shuffle_epi8(table_1l, _mm256_and_si256(prev1, nibble))),
+					_mm256_shuffle_epi8(table_2h, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+
+				__m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+				__m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+				__m256i must_continue = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+
+				error = _mm256_or_si256(error, _mm256_xor_si256(must_continue, special));
+				incomplete = _mm256_subs_epu8(input, tail);
+			}
+			else {
+				error = _mm256_or_si256(error, incomplete);
+				incomplete = _mm256_setzero_si256();
+			}
+
+			previous = input;
+		}
+
+		valid = _mm256_testz_si256(error, error) != 0;
+
+		return done;
+	}
+#endif
+}
+
+word misc::base64_encoded_size(word length, bool padding) {
+	return padding ? 4 * ((length + 2) / 3) : (4 * length + 2) / 3;
+}
+
+word misc::base64_decoded_size(word length) {
+	return 3 * ((length + 3) / 4);
+}
+
+word misc::base64_encode(const uint8* data, word length, char* target, base64_alphabet alphabet, bool padding) {
+	cstr characters = characters_for(alphabet);
+	word i = 0, j = 0;
+
+#ifdef X86
+	if (cpu::has_avx2())
+		i = encode_avx2(data, length, target, characters);
+	else if (cpu::has_ssse3())
+		i = encode_ssse3(data, length, target, characters);
+
+	j = i / 3 * 4;
+#endif
+
+	for (; i + 3 <= length; i += 3) {
+		uint32 triple = (data[i] << 0x10) | (data[i + 1] << 0x08) | data[i + 2];
+
+		target[j++] = characters[(triple >> 3 * 6) & 0x3F];
+		target[j++] = characters[(triple >> 2 * 6) & 0x3F];
+		target[j++] = characters[(triple >> 1 * 6) & 0x3F];
+		target[j++] = characters[(triple >> 0 * 6) & 0x3F];
+	}
+
+	if (i < length) {
+		uint32 triple = (data[i] << 0x10) | (i + 1 < length ? data[i + 1] << 0x08 : 0);
+
+		target[j++] = characters[(triple >> 3 * 6) & 0x3F];
+		target[j++] = characters[(triple >> 2 * 6) & 0x3F];
+
+		if (i + 1 < length)
+			target[j++] = characters[(triple >> 1 * 6) & 0x3F];
+		else if (padding)
+			target[j++] = '=';
+
+		if (padding)
+			target[j++] = '=';
+	}
+
+	return j;
+}
+
+string misc::base64_encode(const uint8* data, word length, base64_alphabet alphabet, bool padding) {
+	string result;
+	result.resize(misc::base64_encoded_size(length, padding));
+
+	misc::base64_encode(data, length, &result[0], alphabet, padding);
+
+	return result;
+}
+
+word misc::base64_decode(cstr data, word length, uint8* target, base64_alphabet alphabet) {
+	const uint8* values = values_for(alphabet);
+	const uint8* input = reinterpret_cast<const uint8*>(data);
+	word i = 0, j = 0;
+
+	if (length % 4 == 0 && length != 0 && data[length - 1] == '=')
+		length -= data[length - 2] == '=' ? 2 : 1;
+
+	if (length % 4 == 1)
+		throw invalid_base64();
+
+#ifdef X86
+	cstr characters = characters_for(alphabet);
+
+	if (cpu::has_avx2())
+		i = decode_avx2(input, length, target, characters);
+	else if (cpu::has_ssse3())
+		i = decode_ssse3(input, length, target, characters);
+
+	j = i / 4 * 3;
+#endif
+
+	for (; i + 4 <= length; i += 4) {
+		uint32 a = values[input[i]], b = values[input[i + 1]], c = values[input[i + 2]], d = values[input[i + 3]];
+
+		if ((a | b | c | d) & 0x80)
+			throw invalid_base64();
+
+		uint32 triple = (a << 3 * 6) | (b << 2 * 6) | (c << 1 * 6) | d;
+
+		target[j++] = static_cast<uint8>(triple >> 0x10);
+		target[j++] = static_cast<uint8>(triple >> 0x08);
+		target[j++] = static_cast<uint8>(triple);
+	}
+
+	if (i < length) {
+		uint32 a = values[input[i]], b = values[input[i + 1]], c = i + 2 < length ? values[input[i + 2]] : 0;
+
+		if ((a | b | c) & 0x80)
+			throw invalid_base64();
+
+		uint32 triple = (a << 3 * 6) | (b << 2 * 6) | (c << 1 * 6);
+		uint32 unused = i + 2 < length ? triple & 0xFF : triple & 0xFFFF;
+
+		//Bits past the last encoded byte must be zero or the encoding isn't canonical.
+		if (unused != 0)
+			throw invalid_base64();
+
+		target[j++] = static_cast<uint8>(triple >> 0x10);
+
+		if (i + 2 < length)
+			target[j++] = static_cast<uint8>(triple >> 0x08);
+	}
+
+	return j;
+}
+
+vector<uint8> misc::base64_decode(const string& data, base64_alphabet alphabet) {
+	vector<uint8> result(misc::base64_decoded_size(static_cast<word>(data.size())));
+
+	result.resize(misc::base64_decode(data.data(), static_cast<word>(data.size()), result.data(), alphabet));
+
+	return result;
+}
+
+bool misc::is_string_utf8(const string& str) {
+	return misc::is_string_utf8(reinterpret_cast<const uint8*>(str.data()), static_cast<word>(str.size()));
+}
+
+bool misc::is_string_utf8(const uint8* bytes, word length) {
+	word done = 0;
+
+#ifdef X86
+	bool valid = true;
+
+	if (cpu::has_avx2())
+		done = validate_avx2(bytes, length, valid);
+	else if (cpu::has_ssse3())
+		done = validate_ssse3(bytes, length, valid);
+
+	if (!valid)
+		return false;
+
+	//The vector loop never sees the bytes after its last block, so the
+	//character that straddles it is checked again by the scalar validator.
+	if (done != 0) {
+		word limit = done - 3;
+
+		while (done > limit && (bytes[done - 1] & 0xC0) == 0x80)
+			done--;
+
+		if (bytes[done - 1] >= 0xC0)
+			done--;
 	}
+#endif
 
-	return true;
+	return is_utf8_scalar(bytes + done, length - done);
 }
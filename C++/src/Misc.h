@@ -1,22 +1,82 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "Common.h"
 
 namespace util {
 	namespace misc {
+		class invalid_base64 {};
+
+		/**
+		 * Characters used for the values 62 and 63: '+' and '/' for
+		 * standard base64, '-' and '_' for the URL and filename safe
+		 * alphabet of RFC 4648.
+		 */
+		enum class base64_alphabet {
+			standard,
+			url
+		};
+
+		/**
+		 * @return the number of characters base64_encode writes for @a
+		 * length bytes
+		 */
+		word base64_encoded_size(word length, bool padding = true);
+
+		/**
+		 * @return an upper bound on the number of bytes base64_decode
+		 * writes for @a length characters
+		 */
+		word base64_decoded_size(word length);
+
+		/**
+		 * Encode @a length bytes from @a data as base64 into @a target,
+		 * which must hold base64_encoded_size(@a length, @a padding)
+		 * characters. Uses SSSE3 or AVX2 when the processor supports them.
+		 *
+		 * @return the number of characters written
+		 */
+		word base64_encode(const uint8* data, word length, char* target, base64_alphabet alphabet = base64_alphabet::standard, bool padding = true);
+
 		/**
-		 * Encode @a dataLength bytes from @a data as a base64 ASCII string
+		 * Encode @a length bytes from @a data as a base64 ASCII string
 		 */
-		std::string base64_encode(const uint8* data, word length);
+		std::string base64_encode(const uint8* data, word length, base64_alphabet alphabet = base64_alphabet::standard, bool padding = true);
+
+		/**
+		 * Decode @a length base64 characters from @a data into @a target,
+		 * which must hold base64_decoded_size(@a length) bytes. Padding is
+		 * optional, but if present must make the length a multiple of four.
+		 *
+		 * @return the number of bytes written
+		 *
+		 * @throws invalid_base64 if @a data contains characters outside
+		 * @a alphabet, misplaced padding or non-zero trailing bits
+		 */
+		word base64_decode(cstr data, word length, uint8* target, base64_alphabet alphabet = base64_alphabet::standard);
+
+		/**
+		 * Decode the base64 string @a data
+		 *
+		 * @throws invalid_base64 if @a data isn't valid base64
+		 */
+		std::vector<uint8> base64_decode(const std::string& data, base64_alphabet alphabet = base64_alphabet::standard);
 
 		/**
 		 * @return true if @a str is a valid UTF-8 encoded string, false
 		 * otherwise
+		 */
+		bool is_string_utf8(const std::string& str);
+
+		/**
+		 * @return true if the @a length bytes at @a data are valid UTF-8 as
+		 * defined by RFC 3629, false otherwise. Uses SSSE3 or AVX2 when the
+		 * processor supports them.
 		 *
 		 * @warning Does NOT check normalization etc!
 		 */
-		bool is_string_utf8(const std::string& str);
+		bool is_string_utf8(const uint8* data, word length);
 	}
 }
@@ -19,17 +19,20 @@ void request_server::on_client_connect_hack(unique_ptr<tcp_connection> connectio
 request_server::request_server() : incoming(0) , outgoing(0) {
 	this->running = false;
 	this->valid = false;
+	this->category_lanes.fill(static_cast<word>(-1));
 }
 
-request_server::request_server(endpoint port, word workers, uint16 retry_code) : request_server(vector<endpoint>{ port }, workers, retry_code) {
+request_server::request_server(endpoint port, word workers, uint16 retry_code, word max_queued) : request_server(vector<endpoint>{ port }, workers, retry_code, max_queued) {
 	
 }
 
-request_server::request_server(vector<endpoint> ports, word workers, uint16 retry_code) : incoming(workers) , outgoing(workers) {
+request_server::request_server(vector<endpoint> ports, word workers, uint16 retry_code, word max_queued) : incoming(workers, chrono::microseconds(0), work_scheduling::work_stealing) , outgoing(workers, chrono::microseconds(0), work_scheduling::work_stealing) {
 	this->running = false;
 	this->valid = true;
 	this->retry_code = retry_code;
-	this->io_worker.on_data += bind(&request_server::on_data, this, placeholders::_1);
+	this->category_lanes.fill(static_cast<word>(-1));
+	this->incoming.set_capacity(max_queued, overflow_policy::block);
+	this->io_worker.on_data += { this, &request_server::on_data };
 
 	for (word i = 0; i < ports.size(); i++) {
 		this->servers.emplace_back(ports[i]);
@@ -38,7 +41,7 @@ request_server::request_server(vector<endpoint> ports, word workers, uint16 retr
 		server.state = this;
 		server.on_connect += &request_server::on_client_connect_hack;
 #else
-		server.on_connect += bind(&request_server::on_client_connect, this, placeholders::_1);
+		server.on_connect += { this, &request_server::on_client_connect };
 #endif
 	}
 }
@@ -57,6 +60,7 @@ request_server& request_server::operator = (request_server&& other) {
 
 	this->valid = other.valid.load();
 	this->retry_code = other.retry_code;
+	this->category_lanes = other.category_lanes;
 	this->running = false;
 	this->servers = move(other.servers);
 	this->incoming = move(other.incoming);
@@ -78,8 +82,8 @@ void request_server::start() {
 
 	this->running = true;
 
-	this->incoming.on_item += std::bind(&request_server::on_incoming, this, placeholders::_1, placeholders::_2);
-	this->outgoing.on_item += std::bind(&request_server::on_outgoing, this, placeholders::_1, placeholders::_2);
+	this->incoming.on_item += { this, &request_server::on_incoming };
+	this->outgoing.on_item += { this, &request_server::on_outgoing };
 
 	this->incoming.start();
 	this->outgoing.start();
@@ -114,6 +118,14 @@ shared_ptr<tcp_connection> request_server::adopt(tcp_connection&& connection, bo
 	return shared;
 }
 
+void request_server::set_lanes(lane_scheduler scheduler) {
+	this->incoming.set_lanes(scheduler);
+}
+
+void request_server::set_priority(uint8 category, word lane) {
+	this->category_lanes[category] = lane;
+}
+
 void request_server::on_client_connect(unique_ptr<tcp_connection> connection) {
 	unique_lock<recursive_mutex> lck(this->client_lock);
 
@@ -141,7 +153,7 @@ void request_server::on_incoming(word worker_number, message& request) {
 
 	uint16 id;
 	uint8 category, method;
-	request.data >> id >> category >> method;
+	request.data.read_region(4) >> id >> category >> method;
 
 	message response(request.connection, id);
 
@@ -165,7 +177,10 @@ void request_server::on_incoming(word worker_number, message& request) {
 void request_server::on_outgoing(word worker_number, message& response) {
 	if (response.connection->connected()) {
 		try {
-			response.connection->send(response.data.data(), response.data.size());
+			segmented_stream stream;
+			stream.append(move(response.data));
+
+			response.connection->send(stream);
 		}
 		catch (tcp_connection::not_connected_exception) {
 
@@ -190,8 +205,10 @@ void request_server::enqueue_incoming(message m) {
 	if (!this->running)
 		return;
 
+	word lane = m.data.size() >= 4 ? this->category_lanes[m.data.data()[2]] : static_cast<word>(-1);
+
 	m.data.seek(0);
-	this->incoming.add_work(move(m));
+	this->incoming.add_work(move(m), lane);
 }
 
 void request_server::enqueue_outgoing(message m) {
@@ -202,7 +219,7 @@ void request_server::enqueue_outgoing(message m) {
 	this->outgoing.add_work(move(m));
 }
 
-request_server::message::message(shared_ptr<tcp_connection> connection, tcp_connection::message message) : connection(connection), data(message.data, message.length) {
+request_server::message::message(shared_ptr<tcp_connection> connection, tcp_connection::message message) : connection(connection), data(message.data, message.length, buffer_pool::shared()) {
 	message.data = nullptr;
 	message.length = 0;
 	this->attempts = 0;
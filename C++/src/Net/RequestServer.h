@@ -2,12 +2,14 @@
 
 #include <atomic>
 #include <vector>
+#include <array>
 #include <list>
 #include <thread>
 #include <memory>
 
 #include "../Common.h"
 #include "../DataStream.h"
+#include "../SegmentedStream.h"
 #include "../WorkProcessor.h"
 #include "../Event.h"
 #include "TCPServer.h"
@@ -47,13 +49,34 @@ namespace util {
 				static const word max_retries = 5;
 
 				request_server();
-				request_server(net::endpoint port, word workers, uint16 retry_code);
-				request_server(std::vector<net::endpoint> ports, word workers, uint16 retry_code);
+
+				/**
+				* When @a max_queued is non-zero, at most that many incoming
+				* requests wait for a worker. The io thread blocks once the
+				* limit is reached, which stops it from reading the sockets
+				* until the workers catch up.
+				*/
+				request_server(net::endpoint port, word workers, uint16 retry_code, word max_queued = 0);
+				request_server(std::vector<net::endpoint> ports, word workers, uint16 retry_code, word max_queued = 0);
 				request_server(request_server&& other);
 				~request_server();
 
 				request_server& operator=(request_server&& other); 
 
+				/**
+				* Splits incoming requests into the priority lanes chosen by
+				* @a scheduler. Requests whose category was not given a lane
+				* with set_priority go to the lowest priority lane. Must be
+				* called before start.
+				*/
+				void set_lanes(lane_scheduler scheduler);
+
+				/**
+				* Queues requests of @a category in @a lane, with lane zero
+				* having the highest priority.
+				*/
+				void set_priority(uint8 category, word lane);
+
 				void enqueue_incoming(message message);
 				void enqueue_outgoing(message message);
 
@@ -78,6 +101,7 @@ namespace util {
 				async_worker io_worker;
 
 				uint16 retry_code;
+				std::array<word, 256> category_lanes;
 
 				std::atomic<bool> running;
 				std::atomic<bool> valid;
@@ -21,6 +21,8 @@
 #elif defined POSIX
 	#include <sys/select.h>
 	#include <sys/socket.h>
+	#include <sys/uio.h>
+	#include <limits.h>
 	#include <sys/types.h>
 	#include <netinet/in.h>
 	#include <unistd.h>
@@ -260,6 +262,45 @@ word socket::write(const uint8* buffer, word count) {
 	return static_cast<word>(::send(this->raw_socket, reinterpret_cast<const char*>(buffer), static_cast<int>(count), 0));
 }
 
+word socket::write(const segmented_stream::segment* segments, word count) {
+	if (!this->connected)
+		throw not_connected_exception();
+
+	if (count == 0)
+		return 0;
+
+#ifdef WINDOWS
+	vector<WSABUF> buffers(count);
+	DWORD sent = 0;
+
+	for (word i = 0; i < count; i++) {
+		buffers[i].buf = reinterpret_cast<char*>(const_cast<uint8*>(segments[i].data));
+		buffers[i].len = static_cast<ULONG>(segments[i].length);
+	}
+
+	if (::WSASend(this->raw_socket, buffers.data(), static_cast<DWORD>(count), &sent, 0, nullptr, nullptr) != 0)
+		return 0;
+
+	return static_cast<word>(sent);
+#elif defined POSIX
+	iovec buffers[IOV_MAX];
+
+	if (count > IOV_MAX)
+		count = IOV_MAX;
+
+	for (word i = 0; i < count; i++) {
+		buffers[i].iov_base = const_cast<uint8*>(segments[i].data);
+		buffers[i].iov_len = segments[i].length;
+	}
+
+	ssize_t sent = ::writev(this->raw_socket, buffers, static_cast<int>(count));
+	if (sent <= 0)
+		return 0;
+
+	return static_cast<word>(sent);
+#endif
+}
+
 array<uint8, socket::address_length> socket::remote_address() const {
 	if (!this->connected)
 		throw not_connected_exception();
@@ -293,7 +334,7 @@ bool socket::data_available() const {
 
 async_worker::async_worker() : timer(chrono::milliseconds(1)) {
 	this->index = 0;
-	this->timer.on_tick += bind(&async_worker::tick, this);
+	this->timer.on_tick += { this, &async_worker::tick };
 	this->timer.start();
 }
 
@@ -10,6 +10,7 @@
 #include "../Common.h"
 #include "../Event.h"
 #include "../Timer.h"
+#include "../SegmentedStream.h"
 
 namespace util {
 	namespace net {
@@ -95,6 +96,14 @@ namespace util {
 				 */
 				word write(const uint8* buffer, word count);
 
+				/**
+				 * Write the @a count buffers in @a segments to the stream, in
+				 * order, with a single gather write
+				 *
+				 * @returns Number of bytes written
+				 */
+				word write(const segmented_stream::segment* segments, word count);
+
 				/**
 				 * @returns Address of the host on the other end of a socket
 				 * returned from @a accept(). Is always an IPv6 address (for now),
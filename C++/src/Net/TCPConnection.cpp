@@ -129,6 +129,23 @@ bool tcp_connection::send(const uint8* buffer, word length) {
 	return true;
 }
 
+bool tcp_connection::send(const segmented_stream& data) {
+	if (!this->connected())
+		throw not_connected_exception();
+
+	word length = data.size();
+
+	if (length > 0xFFFF)
+		throw message_too_long_exception();
+
+	vector<segmented_stream::segment> segments;
+	segments.reserve(data.segments().size() + 1);
+	segments.push_back(segmented_stream::segment { reinterpret_cast<uint8*>(&length), tcp_connection::message_length_bytes });
+	segments.insert(segments.end(), data.segments().begin(), data.segments().end());
+
+	return this->ensure_write(segments);
+}
+
 void tcp_connection::enqueue(const uint8* buffer, word length) {
 	this->queued.emplace_back(buffer, length);
 }
@@ -186,6 +203,28 @@ bool tcp_connection::ensure_write(const uint8* data, word count) {
 	return sent == count;
 }
 
+bool tcp_connection::ensure_write(vector<segmented_stream::segment>& segments) {
+	if (!this->connected())
+		throw not_connected_exception();
+
+	word first = 0;
+	for (word i = 0; i < 10 && first < segments.size(); i++) {
+		word sent = this->connection.write(segments.data() + first, segments.size() - first);
+
+		for (; first < segments.size() && sent >= segments[first].length; first++)
+			sent -= segments[first].length;
+
+		if (first < segments.size()) {
+			segments[first].data += sent;
+			segments[first].length -= sent;
+		}
+
+		this_thread::sleep_for(chrono::microseconds(i * 10));
+	}
+
+	return first == segments.size();
+}
+
 tcp_connection::message::message(bool closed) {
 	this->closed = closed;
 	this->length = 0;
@@ -195,13 +234,13 @@ tcp_connection::message::message(bool closed) {
 tcp_connection::message::message(const uint8* buffer, word length) {
 	this->closed = false;
 	this->length = length;
-	this->data = new uint8[length];
+	this->data = buffer_pool::shared().allocate(data_stream::allocation_for(length));
 	memcpy(this->data, buffer, length);
 }
 
 tcp_connection::message::~message() {
 	if (this->data)
-		delete[] this->data;
+		buffer_pool::shared().release(this->data, data_stream::allocation_for(this->length));
 }
 
 tcp_connection::message::message(const tcp_connection::message& other) {
@@ -215,14 +254,18 @@ tcp_connection::message::message(tcp_connection::message&& other) {
 }
 
 tcp_connection::message& tcp_connection::message::operator=(const tcp_connection::message& other) {
+	if (this == &other)
+		return *this;
+
 	if (this->data)
-		delete[] this->data;
+		buffer_pool::shared().release(this->data, data_stream::allocation_for(this->length));
 
-	this->data = other.data;
+	this->data = other.data ? buffer_pool::shared().allocate(data_stream::allocation_for(other.length)) : nullptr;
 	this->length = other.length;
 	this->closed = other.closed;
 
-	memcpy(this->data, other.data, this->length);
+	if (this->data)
+		memcpy(this->data, other.data, this->length);
 
 	return *this;
 }
@@ -230,7 +273,7 @@ tcp_connection::message& tcp_connection::message::operator=(const tcp_connection
 
 tcp_connection::message& tcp_connection::message::operator=(tcp_connection::message&& other) {
 	if (this->data)
-		delete [] this->data;
+		buffer_pool::shared().release(this->data, data_stream::allocation_for(this->length));
 
 	this->data = other.data;
 	this->length = other.length;
@@ -4,6 +4,7 @@
 #include <array>
 
 #include "../Common.h"
+#include "../DataStream.h"
 #include "Socket.h"
 
 namespace util {
@@ -23,6 +24,7 @@ namespace util {
 					word length;
 
 					///The actual message data excluding the length bytes themselves.
+					///Allocated from buffer_pool::shared() with data_stream::allocation_for(length) bytes.
 					uint8* data;
 
 					///A flag signaling that the connection was closed.
@@ -115,6 +117,11 @@ namespace util {
 				///@return True if all the data was sent, false otherwise.
 				virtual bool send(const uint8* buffer, word length);
 
+				///Sends the contents of the given stream as one message using a single gather write.
+				///@param data The data to send. 
+				///@return True if all the data was sent, false otherwise.
+				virtual bool send(const segmented_stream& data);
+
 				///Adds the data to the internal pending queue.
 				///Call send_queued to send all the data queued with this message as one contiguous message
 				///@param buffer The data to send. 
@@ -153,6 +160,7 @@ namespace util {
 				std::vector<message> queued;
 
 				bool ensure_write(const uint8* data, word count);
+				bool ensure_write(std::vector<segmented_stream::segment>& segments);
 		};
 	}
 }
@@ -234,6 +234,41 @@ bool websocket_connection::send(const uint8* data, word length, op_codes code) {
 	return true;
 }
 
+bool websocket_connection::send(const segmented_stream& data) {
+	if (!this->connected())
+		throw tcp_connection::not_connected_exception();
+
+	word length = data.size();
+
+	if (length > 0xFFFF)
+		throw tcp_connection::message_too_long_exception();
+
+	word send_length = 2;
+	uint8 bytes[4];
+	bytes[0] = 128 | static_cast<uint8>(op_codes::binary);
+
+	if (length <= 125) {
+		bytes[1] = static_cast<uint8>(length);
+	}
+	else {
+		bytes[1] = 126;
+		send_length += 2;
+		reinterpret_cast<int16*>(bytes)[1] = net::host_to_net_int16(static_cast<int16>(length));
+	}
+
+	vector<segmented_stream::segment> segments;
+	segments.reserve(data.segments().size() + 1);
+	segments.push_back(segmented_stream::segment { bytes, send_length });
+	segments.insert(segments.end(), data.segments().begin(), data.segments().end());
+
+	if (!this->ensure_write(segments)) {
+		tcp_connection::close();
+		return false;
+	}
+
+	return true;
+}
+
 bool websocket_connection::send_queued() {
 	if (!this->connected())
 		throw tcp_connection::not_connected_exception();
@@ -41,6 +41,7 @@ namespace util {
 
 					virtual std::vector<tcp_connection::message> read(word wait_for = 0) override;
 					virtual bool send(const uint8* data, word length) override;
+					virtual bool send(const segmented_stream& data) override;
 					virtual bool send_queued() override;
 					virtual void close() override;
 
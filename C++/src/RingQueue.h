@@ -0,0 +1,264 @@
+#pragma once
+
+#include <utility>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
+#include <atomic>
+#include <thread>
+#include <new>
+
+#include "Common.h"
+
+namespace util {
+	/**
+	* Bounded multi-producer multi-consumer queue with the same contract as
+	* util::work_queue. Items live in a power-of-two ring of slots, each
+	* tagged with a sequence number, so producers and consumers only contend
+	* on a single compare-and-swap. Consumers park on a condition variable
+	* only when the ring is empty; producers spin when it is full.
+	*/
+	template<typename T> class ring_queue {
+		static_assert(std::is_move_constructible<T>::value, "typename T must be move constructible.");
+
+		static const word cache_line = 64;
+
+		//Each slot has its own cache line so producers and consumers working
+		//on neighbouring slots do not invalidate each other's sequences.
+		struct slot : cache_line_aligned {
+			std::atomic<word> sequence;
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+		};
+
+		std::unique_ptr<slot[]> slots;
+		word mask;
+
+		alignas(cache_line) std::atomic<word> head;
+		alignas(cache_line) std::atomic<word> tail;
+		alignas(cache_line) std::atomic<word> sleepers;
+		std::atomic<word> signals;
+		std::atomic<bool> alive;
+		std::mutex lock;
+		std::condition_variable cv;
+
+		slot* claim(word& position) {
+			position = this->tail.load(std::memory_order_relaxed);
+
+			for (;;) {
+				slot* current = &this->slots[position & this->mask];
+				word sequence = current->sequence.load(std::memory_order_acquire);
+				sword difference = static_cast<sword>(sequence - (position + 1));
+
+				if (difference == 0) {
+					if (this->tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						return current;
+				}
+				else if (difference < 0) {
+					return nullptr;
+				}
+				else {
+					position = this->tail.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		void release(slot* current, word position) {
+			reinterpret_cast<T*>(&current->storage)->~T();
+			current->sequence.store(position + this->mask + 1, std::memory_order_release);
+		}
+
+		void wake() {
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			//A consumer that was signalled but has not run yet will see this
+			//item too, so only take the lock when a sleeper is still unsignalled.
+			if (this->sleepers.load(std::memory_order_acquire) > this->signals.load(std::memory_order_relaxed)) {
+				std::unique_lock<std::mutex> lck(this->lock);
+
+				if (this->sleepers > this->signals) {
+					this->signals++;
+					this->cv.notify_one();
+				}
+			}
+		}
+
+		slot* wait_claim(word& position) {
+			slot* current = this->claim(position);
+
+			if (current)
+				return current;
+
+			std::unique_lock<std::mutex> lck(this->lock);
+
+			this->sleepers.fetch_add(1);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			while ((current = this->claim(position)) == nullptr && this->alive) {
+				this->cv.wait(lck);
+
+				if (this->signals != 0)
+					this->signals--;
+			}
+
+			this->sleepers.fetch_sub(1);
+
+			return current;
+		}
+
+		public:
+			class waiter_killed_exception {};
+
+			ring_queue(const ring_queue& other) = delete;
+			ring_queue& operator=(const ring_queue& other) = delete;
+			ring_queue(ring_queue&& other) = delete;
+			ring_queue& operator=(ring_queue&& other) = delete;
+
+			/**
+			* Creates a queue that holds at least @a capacity items. The
+			* capacity is rounded up to the next power of two.
+			*/
+			ring_queue(word capacity = 1024) {
+				word size = 2;
+				while (size < capacity)
+					size *= 2;
+
+				this->mask = size - 1;
+				this->slots.reset(new slot[size]);
+
+				for (word i = 0; i < size; i++)
+					this->slots[i].sequence.store(i, std::memory_order_relaxed);
+
+				this->head = 0;
+				this->tail = 0;
+				this->sleepers = 0;
+				this->signals = 0;
+				this->alive = true;
+			}
+
+			~ring_queue() {
+				this->kill_waiters();
+
+				word position;
+				slot* current;
+				while ((current = this->claim(position)) != nullptr)
+					this->release(current, position);
+			}
+
+			/**
+			* @returns the number of items the ring can hold
+			*/
+			word capacity() const {
+				return this->mask + 1;
+			}
+
+			/**
+			* Enqueues @a item if there is room for it.
+			*
+			* @returns false if the queue was full
+			*/
+			bool try_enqueue(T&& item) {
+				word position = this->head.load(std::memory_order_relaxed);
+				slot* current;
+
+				for (;;) {
+					current = &this->slots[position & this->mask];
+					word sequence = current->sequence.load(std::memory_order_acquire);
+					sword difference = static_cast<sword>(sequence - position);
+
+					if (difference == 0) {
+						if (this->head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+							break;
+					}
+					else if (difference < 0) {
+						return false;
+					}
+					else {
+						position = this->head.load(std::memory_order_relaxed);
+					}
+				}
+
+				new (&current->storage) T(std::move(item));
+				current->sequence.store(position + 1, std::memory_order_release);
+
+				this->wake();
+
+				return true;
+			}
+
+			/**
+			* Dequeues into @a target without blocking.
+			*
+			* @returns false if the queue was empty
+			*/
+			bool try_dequeue(T& target) {
+				word position;
+				slot* current = this->claim(position);
+
+				if (!current)
+					return false;
+
+				T* stored = reinterpret_cast<T*>(&current->storage);
+				target = std::move(*stored);
+				this->release(current, position);
+
+				return true;
+			}
+
+			/**
+			* Enqueues @a item, yielding while the ring is full.
+			*
+			* @returns false if the waiters were killed before room became
+			* available
+			*/
+			bool enqueue(T&& item) {
+				while (!this->try_enqueue(std::move(item))) {
+					if (!this->alive)
+						return false;
+
+					std::this_thread::yield();
+				}
+
+				return true;
+			}
+
+			bool dequeue(T& target) {
+				if (!this->alive)
+					return false;
+
+				word position;
+				slot* current = this->wait_claim(position);
+
+				if (!current)
+					return false;
+
+				target = std::move(*reinterpret_cast<T*>(&current->storage));
+				this->release(current, position);
+
+				return true;
+			}
+
+			T dequeue() {
+				if (!this->alive)
+					throw waiter_killed_exception();
+
+				word position;
+				slot* current = this->wait_claim(position);
+
+				if (!current)
+					throw waiter_killed_exception();
+
+				T request(std::move(*reinterpret_cast<T*>(&current->storage)));
+				this->release(current, position);
+
+				return request;
+			}
+
+			void kill_waiters() {
+				std::unique_lock<std::mutex> lck(this->lock);
+
+				this->alive = false;
+				this->cv.notify_all();
+			}
+	};
+}
@@ -0,0 +1,147 @@
+#include "SegmentedStream.h"
+
+#include <cstring>
+#include <utility>
+
+using namespace std;
+using namespace util;
+
+segmented_stream::segmented_stream() : segmented_stream(buffer_pool::shared()) {
+
+}
+
+segmented_stream::segmented_stream(buffer_pool& pool) {
+	this->pool = &pool;
+	this->tail = nullptr;
+	this->tail_part = 0;
+	this->tail_free = 0;
+	this->length = 0;
+}
+
+segmented_stream::segmented_stream(segmented_stream&& other) : segmented_stream(*other.pool) {
+	*this = move(other);
+}
+
+segmented_stream::~segmented_stream() {
+	this->clear();
+}
+
+segmented_stream& segmented_stream::operator=(segmented_stream&& other) {
+	if (this == &other)
+		return *this;
+
+	this->clear();
+
+	this->pool = other.pool;
+	this->parts = move(other.parts);
+	this->chunks = move(other.chunks);
+	this->streams = move(other.streams);
+	this->adopted = move(other.adopted);
+	this->tail = other.tail;
+	this->tail_part = other.tail_part;
+	this->tail_free = other.tail_free;
+	this->length = other.length;
+
+	other.parts.clear();
+	other.chunks.clear();
+	other.streams.clear();
+	other.adopted.clear();
+	other.tail = nullptr;
+	other.tail_part = 0;
+	other.tail_free = 0;
+	other.length = 0;
+
+	return *this;
+}
+
+void segmented_stream::write(const uint8* data, word count) {
+	while (count != 0) {
+		if (this->tail_free == 0) {
+			this->chunks.push_back(this->pool->allocate(segmented_stream::chunk_size));
+			this->tail = this->chunks.back();
+			this->tail_free = segmented_stream::chunk_size;
+			this->tail_part = this->parts.size();
+		}
+
+		//A segment linked since the last write ends the chunk's segment, so keep filling the chunk under a new one.
+		if (this->tail_part + 1 != this->parts.size()) {
+			this->parts.push_back(segment { this->tail, 0 });
+			this->tail_part = this->parts.size() - 1;
+		}
+
+		word amount = count < this->tail_free ? count : this->tail_free;
+
+		memcpy(this->tail, data, amount);
+
+		this->parts.back().length += amount;
+		this->tail += amount;
+		this->tail_free -= amount;
+		this->length += amount;
+		data += amount;
+		count -= amount;
+	}
+}
+
+void segmented_stream::write(const string& data) {
+	auto size = static_cast<string_length_type>(data.size());
+
+	this->write(size);
+	this->write(reinterpret_cast<const uint8*>(data.data()), size);
+}
+
+void segmented_stream::append(data_stream&& stream) {
+	if (stream.size() == 0)
+		return;
+
+	this->streams.push_back(move(stream));
+	this->link(this->streams.back().data(), this->streams.back().size());
+}
+
+void segmented_stream::append(const uint8* data, word length) {
+	if (length == 0)
+		return;
+
+	this->link(data, length);
+}
+
+void segmented_stream::adopt(uint8* data, word length) {
+	this->adopted.emplace_back(data);
+	this->link(data, length);
+}
+
+void segmented_stream::link(const uint8* data, word length) {
+	this->parts.push_back(segment { data, length });
+	this->length += length;
+}
+
+void segmented_stream::clear() {
+	for (auto i : this->chunks)
+		this->pool->release(i, segmented_stream::chunk_size);
+
+	this->parts.clear();
+	this->chunks.clear();
+	this->streams.clear();
+	this->adopted.clear();
+	this->tail = nullptr;
+	this->tail_part = 0;
+	this->tail_free = 0;
+	this->length = 0;
+}
+
+word segmented_stream::size() const {
+	return this->length;
+}
+
+const vector<segmented_stream::segment>& segmented_stream::segments() const {
+	return this->parts;
+}
+
+segmented_stream& segmented_stream::operator<<(const string& rhs) {
+	this->write(rhs);
+	return *this;
+}
+
+segmented_stream& segmented_stream::operator<<(data_stream&& rhs) {
+	this->append(move(rhs));
+	return *this;
+}
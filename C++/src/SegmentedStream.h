@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "Common.h"
+#include "BufferPool.h"
+#include "DataStream.h"
+
+namespace util {
+	/**
+	* Write-only stream made of a chain of buffer segments. Appending a
+	* data_stream or an external buffer links it into the chain instead of
+	* copying it, and small writes fill pooled chunks, so nothing written
+	* is ever moved again. The segments can be handed to a socket as one
+	* gather write.
+	*/
+	class segmented_stream {
+		public:
+			struct segment {
+				const uint8* data;
+				word length;
+			};
+
+			static const word chunk_size = 4096;
+
+			segmented_stream();
+
+			/**
+			* Creates a stream whose chunks come from @a pool. @a pool must
+			* outlive the stream.
+			*/
+			explicit segmented_stream(buffer_pool& pool);
+			segmented_stream(segmented_stream&& other);
+			~segmented_stream();
+
+			segmented_stream& operator=(segmented_stream&& other);
+
+			segmented_stream(const segmented_stream& other) = delete;
+			segmented_stream& operator=(const segmented_stream& other) = delete;
+
+			/**
+			* Copies @a count bytes from @a data to the end of the stream.
+			*/
+			void write(const uint8* data, word count);
+
+			/**
+			* Copies the length-prefixed contents of @a data to the end of the
+			* stream, in the same format as data_stream::write.
+			*/
+			void write(const std::string& data);
+
+			/**
+			* Links the contents of @a stream to the end of the stream without
+			* copying them.
+			*/
+			void append(data_stream&& stream);
+
+			/**
+			* Links @a length bytes at @a data to the end of the stream without
+			* copying them. @a data must stay valid until the stream is
+			* cleared or destroyed.
+			*/
+			void append(const uint8* data, word length);
+
+			/**
+			* Links @a length bytes at @a data to the end of the stream and
+			* takes ownership of them. @a data must have been allocated with
+			* new[].
+			*/
+			void adopt(uint8* data, word length);
+
+			/**
+			* Discards all segments.
+			*/
+			void clear();
+
+			/**
+			* @returns the total number of bytes in all segments
+			*/
+			word size() const;
+
+			/**
+			* @returns the segments in order, suitable for a gather write
+			*/
+			const std::vector<segment>& segments() const;
+
+			template<typename T> void write(T data) {
+				static_assert(std::is_arithmetic<T>::value, "segmented_stream::write<T> must be an arithmetic type.");
+				this->write(reinterpret_cast<const uint8*>(&data), sizeof(T));
+			}
+
+			template<typename T> segmented_stream& operator<<(T rhs) {
+				static_assert(std::is_arithmetic<T>::value, "segmented_stream::operator<< of T must be an arithmetic type.");
+				this->write<T>(rhs);
+				return *this;
+			}
+
+			segmented_stream& operator<<(const std::string& rhs);
+			segmented_stream& operator<<(data_stream&& rhs);
+
+		private:
+			typedef uint16 string_length_type;
+
+			buffer_pool* pool;
+			std::vector<segment> parts;
+			std::vector<uint8*> chunks;
+			std::deque<data_stream> streams;
+			std::vector<std::unique_ptr<uint8[]>> adopted;
+			uint8* tail;
+			word tail_part;
+			word tail_free;
+			word length;
+
+			void link(const uint8* data, word length);
+	};
+}
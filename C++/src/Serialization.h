@@ -0,0 +1,223 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <cstring>
+#include <type_traits>
+
+#include "Common.h"
+#include "DataStream.h"
+
+namespace util {
+	/**
+	* Serializes structs that describe their fields once with a static
+	* fields() function returning a tuple of member pointers:
+	*
+	* struct login_request {
+	*     uint32 id;
+	*     std::string name;
+	*
+	*     static auto fields() { return std::make_tuple(&login_request::id, &login_request::name); }
+	* };
+	*
+	* Fields may be arithmetic types, enums, std::string (two byte length
+	* prefix, as written by data_stream), std::vector of a supported type
+	* (two byte count prefix), or other structs with fields(). Specialize
+	* serialization::field for other types.
+	*
+	* Writing computes the encoded size first and claims it from the stream
+	* once. Reading checks the smallest possible size once and only checks
+	* again for variable length fields.
+	*/
+	namespace serialization {
+		typedef uint16 length_type;
+
+		template<typename T, typename Enable = void> struct field;
+
+		template<typename T, typename Enable = void> struct has_fields : std::false_type {};
+		template<typename T> struct has_fields<T, decltype(static_cast<void>(T::fields()))> : std::true_type {};
+
+		template<typename P> struct member_type;
+		template<typename C, typename M> struct member_type<M C::*> {
+			typedef M type;
+		};
+
+		constexpr word sum() {
+			return 0;
+		}
+
+		template<typename... R> constexpr word sum(word first, R... rest) {
+			return first + serialization::sum(rest...);
+		}
+
+		template<typename Tuple> struct fields_minimum_size;
+		template<typename... P> struct fields_minimum_size<std::tuple<P...>> {
+			static const word value = serialization::sum(field<typename member_type<P>::type>::minimum_size...);
+		};
+
+		template<typename T> struct field<T, typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value>::type> {
+			static const word minimum_size = sizeof(T);
+
+			static word size(const T&) {
+				return sizeof(T);
+			}
+
+			static void write(uint8*& out, const T& value) {
+				std::memcpy(out, &value, sizeof(T));
+				out += sizeof(T);
+			}
+
+			static void read(const uint8*& in, word&, T& value) {
+				std::memcpy(&value, in, sizeof(T));
+				in += sizeof(T);
+			}
+		};
+
+		template<> struct field<std::string> {
+			static const word minimum_size = sizeof(length_type);
+
+			static word size(const std::string& value) {
+				return sizeof(length_type) + static_cast<length_type>(value.size());
+			}
+
+			static void write(uint8*& out, const std::string& value) {
+				length_type length = static_cast<length_type>(value.size());
+
+				std::memcpy(out, &length, sizeof(length_type));
+				std::memcpy(out + sizeof(length_type), value.data(), length);
+				out += sizeof(length_type) + length;
+			}
+
+			static void read(const uint8*& in, word& slack, std::string& value) {
+				length_type length;
+
+				std::memcpy(&length, in, sizeof(length_type));
+				in += sizeof(length_type);
+
+				if (length > slack)
+					throw data_stream::read_past_end_exception();
+
+				value.assign(reinterpret_cast<cstr>(in), length);
+				in += length;
+				slack -= length;
+			}
+		};
+
+		template<typename T> struct field<std::vector<T>> {
+			static const word minimum_size = sizeof(length_type);
+
+			static word size(const std::vector<T>& value) {
+				word total = sizeof(length_type);
+				length_type count = static_cast<length_type>(value.size());
+
+				for (length_type i = 0; i < count; i++)
+					total += field<T>::size(value[i]);
+
+				return total;
+			}
+
+			static void write(uint8*& out, const std::vector<T>& value) {
+				length_type count = static_cast<length_type>(value.size());
+
+				std::memcpy(out, &count, sizeof(length_type));
+				out += sizeof(length_type);
+
+				for (length_type i = 0; i < count; i++)
+					field<T>::write(out, value[i]);
+			}
+
+			static void read(const uint8*& in, word& slack, std::vector<T>& value) {
+				length_type count;
+
+				std::memcpy(&count, in, sizeof(length_type));
+				in += sizeof(length_type);
+
+				word needed = count * field<T>::minimum_size;
+				if (needed > slack)
+					throw data_stream::read_past_end_exception();
+
+				slack -= needed;
+
+				value.resize(count);
+				for (auto& i : value)
+					field<T>::read(in, slack, i);
+			}
+		};
+
+		template<typename T> struct field<T, typename std::enable_if<has_fields<T>::value>::type> {
+			typedef decltype(T::fields()) fields_type;
+
+			static const word minimum_size = fields_minimum_size<fields_type>::value;
+
+			template<std::size_t... I> static word size(const T& value, const fields_type& fields, std::index_sequence<I...>) {
+				return serialization::sum(field<typename member_type<typename std::tuple_element<I, fields_type>::type>::type>::size(value.*std::get<I>(fields))...);
+			}
+
+			template<std::size_t... I> static void write(uint8*& out, const T& value, const fields_type& fields, std::index_sequence<I...>) {
+				using expand = int[];
+				static_cast<void>(expand { 0, (field<typename member_type<typename std::tuple_element<I, fields_type>::type>::type>::write(out, value.*std::get<I>(fields)), 0)... });
+			}
+
+			template<std::size_t... I> static void read(const uint8*& in, word& slack, T& value, const fields_type& fields, std::index_sequence<I...>) {
+				using expand = int[];
+				static_cast<void>(expand { 0, (field<typename member_type<typename std::tuple_element<I, fields_type>::type>::type>::read(in, slack, value.*std::get<I>(fields)), 0)... });
+			}
+
+			static word size(const T& value) {
+				return field::size(value, T::fields(), std::make_index_sequence<std::tuple_size<fields_type>::value>());
+			}
+
+			static void write(uint8*& out, const T& value) {
+				field::write(out, value, T::fields(), std::make_index_sequence<std::tuple_size<fields_type>::value>());
+			}
+
+			static void read(const uint8*& in, word& slack, T& value) {
+				field::read(in, slack, value, T::fields(), std::make_index_sequence<std::tuple_size<fields_type>::value>());
+			}
+		};
+
+		/**
+		* @returns the number of bytes write will use for @a value
+		*/
+		template<typename T> word encoded_size(const T& value) {
+			return field<T>::size(value);
+		}
+
+		/**
+		* Writes @a value at the cursor of @a stream.
+		*/
+		template<typename T> void write(data_stream& stream, const T& value) {
+			uint8* out = stream.claim(field<T>::size(value));
+
+			field<T>::write(out, value);
+		}
+
+		/**
+		* Reads @a value from the cursor of @a stream.
+		*/
+		template<typename T> void read(data_stream& stream, T& value) {
+			word available = stream.size() - stream.position();
+
+			if (available < field<T>::minimum_size)
+				throw data_stream::read_past_end_exception();
+
+			word slack = available - field<T>::minimum_size;
+			const uint8* start = stream.data_at_cursor();
+			const uint8* in = start;
+
+			field<T>::read(in, slack, value);
+
+			stream.seek(stream.position() + static_cast<word>(in - start));
+		}
+
+		template<typename T> T read(data_stream& stream) {
+			T value;
+
+			serialization::read(stream, value);
+
+			return value;
+		}
+	}
+}
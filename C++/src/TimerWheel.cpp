@@ -0,0 +1,257 @@
+#include "TimerWheel.h"
+
+#include <utility>
+
+using namespace std;
+using namespace util;
+
+const uint32 timer_wheel::nil;
+
+timer_wheel::timer_wheel(chrono::microseconds resolution, word workers, clock_type clock) : clock(move(clock)), processor(workers) {
+	this->resolution = resolution.count() > 0 ? resolution : chrono::microseconds(1);
+	this->now = 0;
+	this->running = false;
+	this->buckets.fill(timer_wheel::nil);
+
+	if (!this->clock) {
+		auto origin = chrono::steady_clock::now();
+
+		this->clock = [origin] {
+			return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - origin);
+		};
+	}
+
+	this->processor.on_item += [](word, callback_type& callback) {
+		callback();
+	};
+}
+
+timer_wheel::~timer_wheel() {
+	this->stop();
+}
+
+void timer_wheel::start() {
+	if (this->running)
+		return;
+
+	this->running = true;
+	this->processor.start();
+	this->driver = thread(&timer_wheel::run, this);
+}
+
+void timer_wheel::stop() {
+	if (!this->running)
+		return;
+
+	{
+		unique_lock<mutex> lck(this->lock);
+		this->running = false;
+		this->cv.notify_all();
+	}
+
+	this->driver.join();
+	this->processor.stop();
+}
+
+timer_wheel::timer_id timer_wheel::schedule(chrono::microseconds delay, callback_type callback) {
+	return this->add(this->elapsed() + delay.count(), 0, move(callback));
+}
+
+timer_wheel::timer_id timer_wheel::schedule_every(chrono::microseconds period, callback_type callback) {
+	if (period < this->resolution)
+		throw period_too_short();
+
+	return this->add(this->elapsed() + period.count(), period.count(), move(callback));
+}
+
+bool timer_wheel::cancel(timer_id id) {
+	uint32 index = static_cast<uint32>(id);
+	uint32 generation = static_cast<uint32>(id >> 32);
+
+	unique_lock<mutex> lck(this->lock);
+
+	if (index >= this->entries.size())
+		return false;
+
+	auto& current = this->entries[index];
+
+	if (!current.active || current.generation != generation)
+		return false;
+
+	this->unlink(index);
+
+	current.active = false;
+	current.generation++;
+	current.callback = nullptr;
+	this->unused.push_back(index);
+
+	return true;
+}
+
+timer_wheel::timer_id timer_wheel::add(uint64 due, uint64 period, callback_type&& callback) {
+	unique_lock<mutex> lck(this->lock);
+	uint32 index;
+
+	if (!this->unused.empty()) {
+		index = this->unused.back();
+		this->unused.pop_back();
+	}
+	else {
+		index = static_cast<uint32>(this->entries.size());
+		this->entries.emplace_back();
+		this->entries.back().generation = 1;
+	}
+
+	auto& current = this->entries[index];
+
+	current.due = due;
+	current.period = period;
+	current.active = true;
+	current.callback = move(callback);
+
+	this->link(index, this->now + 1);
+
+	return (static_cast<timer_id>(current.generation) << 32) | index;
+}
+
+uint64 timer_wheel::elapsed() const {
+	return static_cast<uint64>(this->clock().count());
+}
+
+uint64 timer_wheel::tick_of(uint64 due) const {
+	uint64 resolution = static_cast<uint64>(this->resolution.count());
+
+	return (due + resolution - 1) / resolution;
+}
+
+void timer_wheel::link(uint32 index, uint64 earliest) {
+	auto& current = this->entries[index];
+	uint64 deadline = this->tick_of(current.due);
+
+	if (deadline < earliest)
+		deadline = earliest;
+
+	uint64 delta = deadline - this->now;
+	word level = 0;
+
+	while (level < timer_wheel::levels - 1 && delta >= (1ULL << ((level + 1) * timer_wheel::level_bits)))
+		level++;
+
+	if (delta >= (1ULL << (timer_wheel::levels * timer_wheel::level_bits)))
+		deadline = this->now + (1ULL << (timer_wheel::levels * timer_wheel::level_bits)) - 1;
+
+	current.bucket = static_cast<uint32>(level * timer_wheel::slots_per_level + ((deadline >> (level * timer_wheel::level_bits)) & (timer_wheel::slots_per_level - 1)));
+	current.previous = timer_wheel::nil;
+	current.next = this->buckets[current.bucket];
+
+	if (current.next != timer_wheel::nil)
+		this->entries[current.next].previous = index;
+
+	this->buckets[current.bucket] = index;
+}
+
+void timer_wheel::unlink(uint32 index) {
+	auto& current = this->entries[index];
+
+	if (current.previous != timer_wheel::nil)
+		this->entries[current.previous].next = current.next;
+	else
+		this->buckets[current.bucket] = current.next;
+
+	if (current.next != timer_wheel::nil)
+		this->entries[current.next].previous = current.previous;
+}
+
+void timer_wheel::advance(vector<callback_type>& fired) {
+	this->now++;
+
+	word highest = 0;
+	while (highest < timer_wheel::levels - 1 && (this->now & ((1ULL << ((highest + 1) * timer_wheel::level_bits)) - 1)) == 0)
+		highest++;
+
+	for (word level = highest; level > 0; level--) {
+		uint32 bucket = static_cast<uint32>(level * timer_wheel::slots_per_level + ((this->now >> (level * timer_wheel::level_bits)) & (timer_wheel::slots_per_level - 1)));
+		uint32 index = this->buckets[bucket];
+
+		this->buckets[bucket] = timer_wheel::nil;
+
+		while (index != timer_wheel::nil) {
+			uint32 next = this->entries[index].next;
+			this->link(index, this->now);
+			index = next;
+		}
+	}
+
+	uint32 bucket = static_cast<uint32>(this->now & (timer_wheel::slots_per_level - 1));
+	uint32 index = this->buckets[bucket];
+
+	this->buckets[bucket] = timer_wheel::nil;
+
+	while (index != timer_wheel::nil) {
+		auto& current = this->entries[index];
+		uint32 next = current.next;
+
+		if (current.period != 0) {
+			fired.push_back(current.callback);
+
+			current.due += current.period;
+			this->link(index, this->now + 1);
+		}
+		else {
+			fired.push_back(move(current.callback));
+
+			current.active = false;
+			current.generation++;
+			current.callback = nullptr;
+			this->unused.push_back(index);
+		}
+
+		index = next;
+	}
+}
+
+void timer_wheel::collect(vector<callback_type>& fired) {
+	unique_lock<mutex> lck(this->lock);
+	uint64 target = this->elapsed() / static_cast<uint64>(this->resolution.count());
+
+	while (this->now < target)
+		this->advance(fired);
+}
+
+void timer_wheel::poll() {
+	vector<callback_type> fired;
+
+	this->collect(fired);
+
+	for (auto& i : fired) {
+		if (this->running)
+			this->processor.add_work(move(i));
+		else
+			i();
+	}
+}
+
+void timer_wheel::run() {
+	vector<callback_type> fired;
+	uint64 resolution = static_cast<uint64>(this->resolution.count());
+
+	while (this->running) {
+		{
+			unique_lock<mutex> lck(this->lock);
+			uint64 next = (this->now + 1) * resolution, current = this->elapsed();
+
+			if (current < next)
+				this->cv.wait_for(lck, chrono::microseconds(next - current), [this] { return !this->running; });
+		}
+
+		if (!this->running)
+			break;
+
+		this->collect(fired);
+
+		for (auto& i : fired)
+			this->processor.add_work(move(i));
+
+		fired.clear();
+	}
+}
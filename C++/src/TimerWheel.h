@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <functional>
+
+#include "Common.h"
+#include "WorkProcessor.h"
+
+namespace util {
+	/**
+	* Schedules many timers from a single driver thread using a hierarchical
+	* timing wheel. Scheduling and cancelling are O(1). Due callbacks are
+	* handed to an internal work_processor so that slow callbacks never
+	* delay the wheel.
+	*
+	* Periodic timers run at a fixed rate: each deadline is computed from
+	* the previous deadline rather than from when the callback ran, so they
+	* do not drift. A period must be at least one tick long.
+	*/
+	class timer_wheel {
+		public:
+			typedef std::function<void()> callback_type;
+			typedef std::function<std::chrono::microseconds()> clock_type;
+			typedef uint64 timer_id;
+
+			static const timer_id invalid_id = 0;
+
+			class period_too_short {};
+
+			/**
+			* @param resolution Length of one tick. Deadlines are rounded up
+			* to the next tick.
+			* @param workers Number of threads that run the callbacks.
+			* @param clock Returns the time since a fixed point. Defaults to
+			* the steady clock measured from construction.
+			*/
+			timer_wheel(std::chrono::microseconds resolution = std::chrono::milliseconds(1), word workers = 1, clock_type clock = clock_type());
+			~timer_wheel();
+
+			timer_wheel(const timer_wheel& other) = delete;
+			timer_wheel(timer_wheel&& other) = delete;
+			timer_wheel& operator=(const timer_wheel& other) = delete;
+			timer_wheel& operator=(timer_wheel&& other) = delete;
+
+			void start();
+			void stop();
+
+			/**
+			* Runs @a callback once after @a delay.
+			*/
+			timer_id schedule(std::chrono::microseconds delay, callback_type callback);
+
+			/**
+			* Runs @a callback every @a period, starting one period from now.
+			*
+			* @throws period_too_short if @a period is shorter than the
+			* resolution
+			*/
+			timer_id schedule_every(std::chrono::microseconds period, callback_type callback);
+
+			/**
+			* Cancels the timer @a id. A callback that has already been handed
+			* to the workers still runs.
+			*
+			* @returns false if the timer had already fired or been cancelled
+			*/
+			bool cancel(timer_id id);
+
+			/**
+			* Advances the wheel to the clock's current time. Due callbacks
+			* are handed to the workers if the wheel is started and run on
+			* the calling thread otherwise, so a wheel with a manual clock
+			* can be driven without the driver thread.
+			*/
+			void poll();
+
+		private:
+			static const word level_bits = 8;
+			static const word slots_per_level = 1 << level_bits;
+			static const word levels = 4;
+			static const uint32 nil = 0xFFFFFFFF;
+
+			struct entry {
+				uint32 generation;
+				uint32 next;
+				uint32 previous;
+				uint32 bucket;
+				uint64 due;
+				uint64 period;
+				bool active;
+				callback_type callback;
+			};
+
+			std::vector<entry> entries;
+			std::vector<uint32> unused;
+			std::array<uint32, levels * slots_per_level> buckets;
+
+			std::chrono::microseconds resolution;
+			clock_type clock;
+			uint64 now;
+
+			std::mutex lock;
+			std::condition_variable cv;
+			std::thread driver;
+			std::atomic<bool> running;
+
+			work_processor<callback_type> processor;
+
+			timer_id add(uint64 due, uint64 period, callback_type&& callback);
+			uint64 elapsed() const;
+			uint64 tick_of(uint64 due) const;
+			void link(uint32 index, uint64 earliest);
+			void unlink(uint32 index);
+			void advance(std::vector<callback_type>& fired);
+			void collect(std::vector<callback_type>& fired);
+			void run();
+	};
+}
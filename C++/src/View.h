@@ -0,0 +1,137 @@
+#pragma once
+
+#include <string>
+#include <cstring>
+#include <functional>
+
+#include "Common.h"
+
+namespace util {
+	/**
+	* Non-owning view of a run of characters, like C++17's std::string_view.
+	* The viewed characters must outlive the view.
+	*/
+	class string_view {
+		cstr start;
+		word length;
+
+		public:
+			string_view() : start(nullptr), length(0) {
+
+			}
+
+			string_view(cstr data, word length) : start(data), length(length) {
+
+			}
+
+			string_view(cstr data) : start(data), length(static_cast<word>(std::strlen(data))) {
+
+			}
+
+			string_view(const std::string& data) : start(data.data()), length(static_cast<word>(data.size())) {
+
+			}
+
+			cstr data() const {
+				return this->start;
+			}
+
+			word size() const {
+				return this->length;
+			}
+
+			bool empty() const {
+				return this->length == 0;
+			}
+
+			cstr begin() const {
+				return this->start;
+			}
+
+			cstr end() const {
+				return this->start + this->length;
+			}
+
+			char operator[](word index) const {
+				return this->start[index];
+			}
+
+			std::string to_string() const {
+				return std::string(this->start, this->length);
+			}
+
+			explicit operator std::string() const {
+				return this->to_string();
+			}
+
+			friend bool operator==(string_view lhs, string_view rhs) {
+				return lhs.length == rhs.length && (lhs.length == 0 || std::memcmp(lhs.start, rhs.start, lhs.length) == 0);
+			}
+
+			friend bool operator!=(string_view lhs, string_view rhs) {
+				return !(lhs == rhs);
+			}
+
+			friend bool operator<(string_view lhs, string_view rhs) {
+				word shorter = lhs.length < rhs.length ? lhs.length : rhs.length;
+				int result = shorter == 0 ? 0 : std::memcmp(lhs.start, rhs.start, shorter);
+
+				return result < 0 || (result == 0 && lhs.length < rhs.length);
+			}
+	};
+
+	/**
+	* Non-owning view of @a size() contiguous values of type T. The viewed
+	* values must outlive the span.
+	*/
+	template<typename T> class span {
+		T* start;
+		word length;
+
+		public:
+			span() : start(nullptr), length(0) {
+
+			}
+
+			span(T* data, word length) : start(data), length(length) {
+
+			}
+
+			T* data() const {
+				return this->start;
+			}
+
+			word size() const {
+				return this->length;
+			}
+
+			bool empty() const {
+				return this->length == 0;
+			}
+
+			T* begin() const {
+				return this->start;
+			}
+
+			T* end() const {
+				return this->start + this->length;
+			}
+
+			T& operator[](word index) const {
+				return this->start[index];
+			}
+	};
+}
+
+namespace std {
+	template<> struct hash<util::string_view> {
+		size_t operator()(util::string_view value) const {
+			uint64 result = 14695981039346656037ULL;
+
+			for (auto i : value)
+				result = (result ^ static_cast<uint8>(i)) * 1099511628211ULL;
+
+			return static_cast<size_t>(result);
+		}
+	};
+}
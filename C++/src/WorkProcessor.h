@@ -1,48 +1,380 @@
 #pragma once
 
 #include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 #include <atomic>
 #include <chrono>
+#include <thread>
 #include <utility>
-#include <functional>
 
 #include "Common.h"
 #include "Event.h"
 #include "WorkQueue.h"
-#include "Timer.h"
 
 namespace util {
+	enum class work_scheduling {
+		shared,
+		work_stealing
+	};
+
 	template<typename T> class work_processor {
 		static_assert(std::is_move_constructible<T>::value, "typename T must be move constructible.");
 
 		public:
+			/**
+			* Where one worker's time has gone since the processor was created.
+			* Busy time is spent in on_item and on_batch, spin time polling for
+			* work before parking, and idle time parked or sleeping for the
+			* delay.
+			*/
+			struct worker_statistics {
+				std::chrono::nanoseconds busy;
+				std::chrono::nanoseconds idle;
+				std::chrono::nanoseconds spin;
+				uint64 items;
+			};
+
 			event_single<void, word, T&> on_item;
+			event_single<void, word, std::vector<T>&> on_batch;
 
 		private:
+			struct worker_counters : cache_line_aligned {
+				std::atomic<uint64> busy;
+				std::atomic<uint64> idle;
+				std::atomic<uint64> spin;
+				std::atomic<uint64> items;
+
+				worker_counters() : busy(0), idle(0), spin(0), items(0) {
+
+				}
+			};
+
+			struct local_queue : cache_line_aligned {
+				std::mutex lock;
+				std::deque<std::deque<T>> items;
+				lane_scheduler scheduler;
+				word count;
+
+				local_queue() : items(1), count(0) {
+
+				}
+
+				std::deque<T>& next_lane() {
+					this->count--;
+
+					return this->items[this->scheduler.select([this](word lane) { return !this->items[lane].empty(); })];
+				}
+
+				bool drop_oldest() {
+					for (word i = this->items.size(); i > 0; i--) {
+						if (!this->items[i - 1].empty()) {
+							this->items[i - 1].pop_front();
+							this->count--;
+
+							return true;
+						}
+					}
+
+					return false;
+				}
+			};
+
+			static threadlocal work_processor* current_processor;
+			static threadlocal word current_worker;
+
 			work_queue<T> queue;
 			std::atomic<bool> running;
-			std::vector<timer<word>> workers;
+			std::vector<std::thread> workers;
+			std::vector<std::unique_ptr<worker_counters>> counters;
+			std::vector<std::vector<T>> batches;
+			std::chrono::microseconds delay;
+			word worker_count;
+			word batch_size;
+			word spin_limit;
+
+			work_scheduling scheduling;
+			std::vector<std::unique_ptr<local_queue>> locals;
+			std::atomic<word> next_local;
+			std::atomic<word> sleepers;
+			std::mutex idle_lock;
+			std::condition_variable idle_cv;
+
+			word capacity;
+			overflow_policy policy;
+			std::atomic<bool> alive;
+			std::atomic<word> depth;
+			std::atomic<word> high_watermark_value;
+			std::atomic<word> blocked;
+			std::mutex space_lock;
+			std::condition_variable space_cv;
+
+			static void elapse(std::atomic<uint64>& counter, std::chrono::steady_clock::time_point& since) {
+				auto now = std::chrono::steady_clock::now();
+
+				counter.fetch_add(static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - since).count()), std::memory_order_relaxed);
+				since = now;
+			}
+
+			void run(word worker) {
+				work_processor::current_processor = this;
+				work_processor::current_worker = worker;
+
+				auto& counters = *this->counters[worker];
+				auto& batch = this->batches[worker];
+				auto since = std::chrono::steady_clock::now();
+
+				while (this->running) {
+					bool found = this->take(worker, batch, false);
+
+					if (!found && this->spin_limit != 0) {
+						for (word i = 0; i < this->spin_limit && !found && this->running; i++) {
+							std::this_thread::yield();
+							found = this->take(worker, batch, false);
+						}
+
+						work_processor::elapse(counters.spin, since);
+					}
+
+					if (!found) {
+						found = this->take(worker, batch, true);
+
+						work_processor::elapse(counters.idle, since);
+					}
+
+					if (!found)
+						continue;
+
+					counters.items.fetch_add(batch.size(), std::memory_order_relaxed);
+
+					this->dispatch(worker, batch);
 
-			void tick(word worker) {
-				try {
-					T item(std::move(this->queue.dequeue()));
-					this->on_item(worker, item);
+					work_processor::elapse(counters.busy, since);
+
+					if (this->delay.count() != 0) {
+						std::this_thread::sleep_for(this->delay);
+
+						work_processor::elapse(counters.idle, since);
+					}
 				}
-				catch (typename work_queue<T>::waiter_killed_exception) {
-					return;
+			}
+
+			void dispatch(word worker, std::vector<T>& batch) {
+				if (this->batch_size > 1)
+					this->on_batch(worker, batch);
+				else
+					this->on_item(worker, batch.front());
+
+				batch.clear();
+			}
+
+			bool take(word worker, std::vector<T>& batch, bool block) {
+				word max = this->batch_size > 1 ? this->batch_size : 1;
+
+				if (this->scheduling == work_scheduling::shared)
+					return (block ? this->queue.dequeue_bulk(batch, max) : this->queue.try_dequeue_bulk(batch, max)) != 0;
+
+				word count = this->locals.size();
+
+				do {
+					for (word i = 0; i < count; i++)
+						if (this->take_local(worker, (worker + i) % count, batch, max))
+							return true;
+				} while (block && this->wait_for_work());
+
+				return false;
+			}
+
+			bool take_local(word worker, word owner, std::vector<T>& batch, word max) {
+				auto& local = *this->locals[owner];
+				std::unique_lock<std::mutex> lck(local.lock, std::defer_lock);
+
+				if (worker == owner)
+					lck.lock();
+				else if (!lck.try_lock())
+					return false;
+
+				if (local.count == 0)
+					return false;
+
+				//Owners and thieves both take the oldest items so work submitted
+				//from outside is served in order; thieves take at most half.
+				word count = worker == owner ? local.count : (local.count + 1) / 2;
+
+				for (word i = 0; i < max && i < count; i++) {
+					auto& lane = local.next_lane();
+
+					batch.push_back(std::move(lane.front()));
+					lane.pop_front();
+				}
+
+				lck.unlock();
+
+				this->release_local(batch.size());
+
+				return true;
+			}
+
+			void push_local(word owner, T&& item, word lane) {
+				auto& local = *this->locals[owner];
+
+				{
+					std::unique_lock<std::mutex> lck(local.lock);
+					local.items[local.scheduler.clamp(lane)].push_back(std::move(item));
+					local.count++;
+				}
+
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				if (this->sleepers.load(std::memory_order_relaxed) != 0) {
+					std::unique_lock<std::mutex> lck(this->idle_lock);
+					this->idle_cv.notify_one();
+				}
+			}
+
+			bool reserve_local(word owner, bool from_worker) {
+				word current = this->depth.load();
+
+				if (this->capacity == 0 || from_worker) {
+					this->raise_high_watermark(this->depth.fetch_add(1) + 1);
+
+					return true;
 				}
+
+				while (current < this->capacity) {
+					if (this->depth.compare_exchange_weak(current, current + 1)) {
+						this->raise_high_watermark(current + 1);
+
+						return true;
+					}
+				}
+
+				switch (this->policy) {
+					case overflow_policy::reject:
+						return false;
+
+					case overflow_policy::drop_oldest:
+						for (word i = 0; i < this->locals.size(); i++) {
+							auto& local = *this->locals[(owner + i) % this->locals.size()];
+							std::unique_lock<std::mutex> lck(local.lock);
+
+							if (local.drop_oldest())
+								return true;
+						}
+
+						this->raise_high_watermark(this->depth.fetch_add(1) + 1);
+
+						return true;
+
+					case overflow_policy::block:
+						break;
+				}
+
+				std::unique_lock<std::mutex> lck(this->space_lock);
+
+				this->blocked.fetch_add(1);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				bool reserved = false;
+				while (this->alive && !reserved) {
+					current = this->depth.load();
+
+					if (current < this->capacity)
+						reserved = this->depth.compare_exchange_weak(current, current + 1);
+					else
+						this->space_cv.wait(lck);
+				}
+
+				this->blocked.fetch_sub(1);
+
+				if (!reserved)
+					return false;
+
+				this->raise_high_watermark(current + 1);
+
+				return true;
+			}
+
+			void release_local(word count) {
+				this->depth.fetch_sub(count);
+
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				if (this->blocked.load(std::memory_order_relaxed) != 0) {
+					std::unique_lock<std::mutex> lck(this->space_lock);
+					this->space_cv.notify_all();
+				}
+			}
+
+			void raise_high_watermark(word value) {
+				word current = this->high_watermark_value.load(std::memory_order_relaxed);
+
+				while (value > current && !this->high_watermark_value.compare_exchange_weak(current, value, std::memory_order_relaxed))
+					;
+			}
+
+			bool has_local_work() {
+				for (auto& i : this->locals) {
+					std::unique_lock<std::mutex> lck(i->lock);
+
+					if (i->count != 0)
+						return true;
+				}
+
+				return false;
+			}
+
+			bool wait_for_work() {
+				std::unique_lock<std::mutex> lck(this->idle_lock);
+
+				this->sleepers.fetch_add(1);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				while (this->running && !this->has_local_work())
+					this->idle_cv.wait(lck);
+
+				this->sleepers.fetch_sub(1);
+
+				return this->running;
 			}
 
 		public:
 			work_processor(const work_processor& other) = delete;
 			work_processor& operator=(const work_processor& other) = delete;
 
-			work_processor(word worker_count, std::chrono::microseconds delay = std::chrono::microseconds(0)) {
+			/**
+			* Creates a processor with @a worker_count workers, each running
+			* on its own thread and parking while there is no work. A worker
+			* sleeps for @a delay after every item or batch it handles. With
+			* work_scheduling::work_stealing each worker owns a local deque:
+			* work added from a worker goes to its own deque, work added from
+			* elsewhere is spread across the deques, and idle workers steal
+			* from the others. Each deque is served oldest first.
+			*/
+			work_processor(word worker_count, std::chrono::microseconds delay = std::chrono::microseconds(0), work_scheduling scheduling = work_scheduling::shared) {
 				this->running = false;
+				this->scheduling = scheduling;
+				this->next_local = 0;
+				this->sleepers = 0;
+				this->delay = delay;
+				this->worker_count = worker_count;
+				this->batch_size = 1;
+				this->spin_limit = 0;
+				this->batches.resize(worker_count);
+				this->capacity = 0;
+				this->policy = overflow_policy::block;
+				this->alive = true;
+				this->depth = 0;
+				this->high_watermark_value = 0;
+				this->blocked = 0;
 
 				for (word i = 0; i < worker_count; i++) {
-					this->workers.emplace_back(delay, i);
-					this->workers.back().on_tick += std::bind(&work_processor::tick, this, std::placeholders::_1);
+					this->counters.emplace_back(new worker_counters());
+
+					if (scheduling == work_scheduling::work_stealing)
+						this->locals.emplace_back(new local_queue());
 				}
 			}
 
@@ -64,7 +396,23 @@ namespace util {
 				this->running = false;
 				this->queue = std::move(other.queue);
 				this->on_item = std::move(other.on_item);
-				this->workers = std::move(other.workers);
+				this->on_batch = std::move(other.on_batch);
+				this->counters = std::move(other.counters);
+				this->batches = std::move(other.batches);
+				this->delay = other.delay;
+				this->worker_count = other.worker_count;
+				this->batch_size = other.batch_size;
+				this->spin_limit = other.spin_limit;
+				this->scheduling = other.scheduling;
+				this->locals = std::move(other.locals);
+				this->next_local = other.next_local.load();
+				this->sleepers = 0;
+				this->capacity = other.capacity;
+				this->policy = other.policy;
+				this->alive = true;
+				this->depth = other.depth.load();
+				this->high_watermark_value = other.high_watermark_value.load();
+				this->blocked = 0;
 
 				if (was_running)
 					this->start();
@@ -72,8 +420,103 @@ namespace util {
 				return *this;
 			}
 
-			void add_work(T&& item) {
-				this->queue.enqueue(std::move(item));
+			/**
+			* Queues @a item in priority lane @a lane for the workers. When
+			* the processor is bounded and full, the overflow policy decides
+			* whether this blocks, rejects the item, or discards the oldest
+			* queued item. Work added by a work-stealing worker to its own
+			* processor is always admitted so that workers cannot block on
+			* themselves.
+			*
+			* @returns false if the item was not queued
+			*/
+			bool add_work(T&& item, word lane = 0) {
+				if (this->locals.empty())
+					return this->queue.enqueue(std::move(item), lane);
+
+				bool from_worker = work_processor::current_processor == this;
+				word owner = from_worker ? work_processor::current_worker : this->next_local.fetch_add(1, std::memory_order_relaxed) % this->locals.size();
+
+				if (!this->reserve_local(owner, from_worker))
+					return false;
+
+				this->push_local(owner, std::move(item), lane);
+
+				return true;
+			}
+
+			/**
+			* Bounds the number of queued items to @a capacity, or removes the
+			* bound if it is zero. Must be called before start.
+			*/
+			void set_capacity(word capacity, overflow_policy policy = overflow_policy::block) {
+				this->capacity = capacity;
+				this->policy = policy;
+				this->queue.set_capacity(capacity, policy);
+			}
+
+			/**
+			* @returns the number of items waiting to be processed
+			*/
+			word size() {
+				return this->locals.empty() ? this->queue.size() : this->depth.load();
+			}
+
+			/**
+			* @returns the largest number of items that has been waiting at once
+			*/
+			word high_watermark() {
+				return this->locals.empty() ? this->queue.high_watermark() : this->high_watermark_value.load();
+			}
+
+			/**
+			* Splits the queued work into priority lanes chosen by
+			* @a scheduler. Lane zero has the highest priority. Must be
+			* called before any work is added.
+			*/
+			void set_lanes(lane_scheduler scheduler) {
+				this->queue.set_lanes(scheduler);
+
+				for (auto& i : this->locals) {
+					i->scheduler = scheduler;
+					i->items.resize(scheduler.lanes());
+				}
+			}
+
+			/**
+			* When @a size is greater than one, workers take up to @a size
+			* items at a time and hand them to on_batch instead of on_item.
+			* Must be called before start.
+			*/
+			void set_batch_size(word size) {
+				this->batch_size = size;
+
+				for (auto& i : this->batches)
+					i.reserve(size);
+			}
+
+			/**
+			* Lets an idle worker poll for work up to @a limit times, yielding
+			* in between, before it parks. Spinning trades CPU for lower
+			* latency when work arrives in quick succession. Must be called
+			* before start.
+			*/
+			void set_spin_limit(word limit) {
+				this->spin_limit = limit;
+			}
+
+			/**
+			* @returns the time and item counters of worker @a worker
+			*/
+			worker_statistics statistics(word worker) const {
+				auto& counters = *this->counters[worker];
+
+				return worker_statistics {
+					std::chrono::nanoseconds(counters.busy.load(std::memory_order_relaxed)),
+					std::chrono::nanoseconds(counters.idle.load(std::memory_order_relaxed)),
+					std::chrono::nanoseconds(counters.spin.load(std::memory_order_relaxed)),
+					counters.items.load(std::memory_order_relaxed)
+				};
 			}
 
 			void start() {
@@ -81,9 +524,11 @@ namespace util {
 					return;
 
 				this->running = true;
+				this->alive = true;
+				this->queue.revive();
 
-				for (auto& i : this->workers)
-					i.start();
+				for (word i = 0; i < this->worker_count; i++)
+					this->workers.emplace_back(&work_processor::run, this, i);
 			}
 
 			void stop() {
@@ -91,11 +536,27 @@ namespace util {
 					return;
 
 				this->running = false;
+				this->alive = false;
 
 				this->queue.kill_waiters();
 
+				{
+					std::unique_lock<std::mutex> lck(this->idle_lock);
+					this->idle_cv.notify_all();
+				}
+
+				{
+					std::unique_lock<std::mutex> lck(this->space_lock);
+					this->space_cv.notify_all();
+				}
+
 				for (auto& i : this->workers)
-					i.stop();
+					i.join();
+
+				this->workers.clear();
 			}
 	};
+
+	template<typename T> threadlocal work_processor<T>* work_processor<T>::current_processor = nullptr;
+	template<typename T> threadlocal word work_processor<T>::current_worker = 0;
 }
@@ -2,6 +2,8 @@
 
 #include <utility>
 #include <queue>
+#include <deque>
+#include <vector>
 #include <mutex>
 #include <condition_variable>
 #include <type_traits>
@@ -10,29 +12,193 @@
 #include "Common.h"
 
 namespace util {
+	/**
+	* What a bounded queue does with an item enqueued while it is full.
+	*/
+	enum class overflow_policy {
+		block,
+		reject,
+		drop_oldest
+	};
+
+	/**
+	* How the next lane is chosen when several priority lanes have items.
+	*/
+	enum class lane_policy {
+		strict,
+		weighted
+	};
+
+	/**
+	* Picks which priority lane to serve next. Lane zero has the highest
+	* priority.
+	*
+	* With lane_policy::strict the highest non-empty lane is served, except
+	* that a lane passed over @a starvation_limit times in a row is served
+	* next. With lane_policy::weighted non-empty lanes are served in
+	* proportion to their weights using smooth weighted round-robin.
+	*/
+	class lane_scheduler {
+		std::vector<word> weights;
+		std::vector<sword> credits;
+		std::vector<word> skipped;
+		lane_policy policy;
+		word starvation_limit;
+
+		public:
+			lane_scheduler(word lanes = 1, lane_policy policy = lane_policy::strict, std::vector<word> weights = std::vector<word>(), word starvation_limit = 64) {
+				if (lanes == 0)
+					lanes = 1;
+
+				this->policy = policy;
+				this->starvation_limit = starvation_limit;
+				this->weights = weights;
+				this->weights.resize(lanes, 1);
+				this->credits.assign(lanes, 0);
+				this->skipped.assign(lanes, 0);
+			}
+
+			word lanes() const {
+				return this->weights.size();
+			}
+
+			/**
+			* @returns @a lane clamped to the lowest priority lane
+			*/
+			word clamp(word lane) const {
+				return lane < this->weights.size() ? lane : this->weights.size() - 1;
+			}
+
+			/**
+			* Chooses the lane to serve next. @a has_items is called with a
+			* lane index and must return whether that lane is non-empty. At
+			* least one lane must have items.
+			*/
+			template<typename F> word select(F&& has_items) {
+				word count = this->weights.size();
+
+				if (count == 1)
+					return 0;
+
+				word chosen = count;
+
+				if (this->policy == lane_policy::weighted) {
+					sword total = 0;
+
+					for (word i = 0; i < count; i++) {
+						if (!has_items(i))
+							continue;
+
+						this->credits[i] += this->weights[i];
+						total += this->weights[i];
+
+						if (chosen == count || this->credits[i] > this->credits[chosen])
+							chosen = i;
+					}
+
+					this->credits[chosen] -= total;
+
+					return chosen;
+				}
+
+				for (word i = count; i > 0; i--)
+					if (this->skipped[i - 1] >= this->starvation_limit && has_items(i - 1))
+						chosen = i - 1;
+
+				if (chosen == count)
+					for (chosen = 0; chosen < count - 1 && !has_items(chosen); chosen++)
+						;
+
+				this->skipped[chosen] = 0;
+
+				for (word i = chosen + 1; i < count; i++)
+					if (has_items(i))
+						this->skipped[i]++;
+
+				return chosen;
+			}
+	};
+
 	template<typename T> class work_queue {
 		static_assert(std::is_move_assignable<T>::value || std::is_move_constructible<T>::value, "typename T must be move assignable and constructible.");
 
-		std::queue<T> items;
+		std::deque<std::queue<T>> items;
+		lane_scheduler scheduler;
+		word count;
 		std::mutex lock;
 		std::condition_variable cv;
+		std::condition_variable space_cv;
 		std::atomic<bool> alive;
 
+		word capacity;
+		word high_watermark_value;
+		overflow_policy policy;
+
+		void release_space() {
+			if (this->capacity != 0 && this->policy == overflow_policy::block)
+				this->space_cv.notify_one();
+		}
+
+		std::queue<T>& next_lane() {
+			return this->items[this->scheduler.select([this](word lane) { return !this->items[lane].empty(); })];
+		}
+
+		T pop() {
+			auto& lane = this->next_lane();
+
+			T item(std::move(lane.front()));
+			lane.pop();
+			this->count--;
+
+			return item;
+		}
+
+		word pop_bulk(std::vector<T>& out, word max) {
+			word taken = 0;
+			for (; taken < max && this->count != 0; taken++)
+				out.push_back(this->pop());
+
+			if (taken != 0 && this->capacity != 0 && this->policy == overflow_policy::block)
+				this->space_cv.notify_all();
+
+			return taken;
+		}
+
+		void drop_oldest() {
+			for (word i = this->items.size(); i > 0; i--) {
+				if (!this->items[i - 1].empty()) {
+					this->items[i - 1].pop();
+					this->count--;
+
+					return;
+				}
+			}
+		}
+
 		public:
 			class waiter_killed_exception {};
 
 			work_queue(const work_queue& other) = delete;
 			work_queue& operator=(const work_queue& other) = delete;
 
-			work_queue() {
+			/**
+			* Creates a queue holding at most @a capacity items, or an
+			* unbounded one if @a capacity is zero. @a policy decides what
+			* enqueue does once the queue is full.
+			*/
+			work_queue(word capacity = 0, overflow_policy policy = overflow_policy::block) : items(1) {
 				this->alive = true;
+				this->count = 0;
+				this->capacity = capacity;
+				this->policy = policy;
+				this->high_watermark_value = 0;
 			}
 
 			~work_queue() {
 				this->kill_waiters();
 			}
 
-			work_queue(work_queue&& other) {
+			work_queue(work_queue&& other) : work_queue() {
 				*this = std::move(other);
 			}
 
@@ -41,14 +207,115 @@ namespace util {
 				std::unique_lock<std::mutex> lck2(other.lock);
 
 				this->items = std::move(other.items);
+				this->scheduler = other.scheduler;
+				this->count = other.count;
+				this->capacity = other.capacity;
+				this->policy = other.policy;
+				this->high_watermark_value = other.high_watermark_value;
+
+				other.items.clear();
+				other.items.resize(other.scheduler.lanes());
+				other.count = 0;
 
 				return *this;
 			}
 
-			void enqueue(T&& item) {
+			void set_capacity(word capacity, overflow_policy policy) {
+				std::unique_lock<std::mutex> lock(this->lock);
+
+				this->capacity = capacity;
+				this->policy = policy;
+				this->space_cv.notify_all();
+			}
+
+			/**
+			* Splits the queue into priority lanes chosen by @a scheduler.
+			* Must be called while the queue is empty.
+			*/
+			void set_lanes(lane_scheduler scheduler) {
 				std::unique_lock<std::mutex> lock(this->lock);
-				this->items.push(std::move(item));
+
+				this->scheduler = scheduler;
+				this->items.resize(scheduler.lanes());
+			}
+
+			/**
+			* Adds @a item to priority lane @a lane. If the queue is full,
+			* blocks until there is room, rejects the item, or discards the
+			* oldest item of the lowest priority non-empty lane depending on
+			* the overflow policy.
+			*
+			* @returns false if the item was rejected or the waiters were
+			* killed while blocked
+			*/
+			bool enqueue(T&& item, word lane = 0) {
+				std::unique_lock<std::mutex> lock(this->lock);
+
+				if (this->capacity != 0 && this->count >= this->capacity) {
+					switch (this->policy) {
+						case overflow_policy::block:
+							while (this->alive && this->capacity != 0 && this->count >= this->capacity)
+								this->space_cv.wait(lock);
+
+							if (!this->alive)
+								return false;
+
+							break;
+
+						case overflow_policy::reject:
+							return false;
+
+						case overflow_policy::drop_oldest:
+							this->drop_oldest();
+
+							break;
+					}
+				}
+
+				this->items[this->scheduler.clamp(lane)].push(std::move(item));
+				this->count++;
+
+				if (this->count > this->high_watermark_value)
+					this->high_watermark_value = this->count;
+
 				this->cv.notify_one();
+
+				return true;
+			}
+
+			/**
+			* @returns the number of items currently queued
+			*/
+			word size() {
+				std::unique_lock<std::mutex> lock(this->lock);
+
+				return this->count;
+			}
+
+			/**
+			* @returns the largest number of items that has been queued at once
+			*/
+			word high_watermark() {
+				std::unique_lock<std::mutex> lock(this->lock);
+
+				return this->high_watermark_value;
+			}
+
+			/**
+			* Dequeues into @a target without blocking.
+			*
+			* @returns false if the queue was empty
+			*/
+			bool try_dequeue(T& target) {
+				std::unique_lock<std::mutex> lock(this->lock);
+
+				if (this->count == 0)
+					return false;
+
+				target = this->pop();
+				this->release_space();
+
+				return true;
 			}
 
 			bool dequeue(T& target) {
@@ -57,15 +324,15 @@ namespace util {
 
 				std::unique_lock<std::mutex> lock(this->lock);
 
-				while (this->items.empty()) {
-					this->cv.wait(lock);
-
+				while (this->count == 0) {
 					if (!this->alive)
 						return false;
+
+					this->cv.wait(lock);
 				}
 
-				target = std::move(this->items.front());
-				this->items.pop();
+				target = this->pop();
+				this->release_space();
 
 				return true;
 			}
@@ -76,22 +343,68 @@ namespace util {
 
 				std::unique_lock<std::mutex> lock(this->lock);
 
-				while (this->items.empty()) {
+				while (this->count == 0) {
+					if (!this->alive)
+						throw waiter_killed_exception();
+
 					this->cv.wait(lock);
+				}
+
+				T request(this->pop());
+				this->release_space();
+
+				return request;
+			}
+
+			/**
+			* Moves up to @a max items into @a out, blocking until at least
+			* one is available.
+			*
+			* @returns the number of items appended, zero once the waiters
+			* have been killed
+			*/
+			word dequeue_bulk(std::vector<T>& out, word max) {
+				if (!this->alive)
+					return 0;
+
+				std::unique_lock<std::mutex> lock(this->lock);
 
+				while (this->count == 0) {
 					if (!this->alive)
-						throw waiter_killed_exception();
+						return 0;
+
+					this->cv.wait(lock);
 				}
 
-				T request(std::move(this->items.front()));
-				this->items.pop();
+				return this->pop_bulk(out, max);
+			}
 
-				return std::move(request);
+			/**
+			* Moves up to @a max items into @a out without blocking.
+			*
+			* @returns the number of items appended
+			*/
+			word try_dequeue_bulk(std::vector<T>& out, word max) {
+				std::unique_lock<std::mutex> lock(this->lock);
+
+				return this->pop_bulk(out, max);
 			}
 
 			void kill_waiters() {
+				std::unique_lock<std::mutex> lock(this->lock);
+
 				this->alive = false;
 				this->cv.notify_all();
+				this->space_cv.notify_all();
+			}
+
+			/**
+			* Lets dequeue block again after kill_waiters.
+			*/
+			void revive() {
+				std::unique_lock<std::mutex> lock(this->lock);
+
+				this->alive = true;
 			}
 	};
 }
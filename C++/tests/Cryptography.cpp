@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <cstdio>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <set>
+
+#include <Utilities/Cryptography.h>
+#include <Utilities/DataStream.h>
+#include <Utilities/SegmentedStream.h>
+
+#ifdef POSIX
+	#include <unistd.h>
+	#include <sys/wait.h>
+#endif
+
+using namespace std;
+using namespace util;
+
+static string hex(const uint8* data, word length) {
+	string result;
+	char digits[3];
+
+	for (word i = 0; i < length; i++) {
+		snprintf(digits, sizeof(digits), "%02x", data[i]);
+		result += digits;
+	}
+
+	return result;
+}
+
+static const uint8* bytes(const string& data) {
+	return reinterpret_cast<const uint8*>(data.data());
+}
+
+TEST(Cryptography, OneShot) {
+	string abc("abc");
+
+	EXPECT_EQ(hex(crypto::calculate_sha1(bytes(abc), 3).data(), crypto::sha1_length), "a9993e364706816aba3e25717850c26c9cd0d89d");
+	EXPECT_EQ(hex(crypto::calculate_sha2(bytes(abc), 3).data(), crypto::sha2_length).substr(0, 32), "ddaf35a193617abacc417349ae204131");
+	EXPECT_EQ(hex(crypto::calculate_sha1(bytes(abc), 3).data(), crypto::sha1_length), "a9993e364706816aba3e25717850c26c9cd0d89d");
+}
+
+TEST(Cryptography, Hasher) {
+	string message("The quick brown fox jumps over the lazy dog");
+	auto expected = crypto::calculate_sha2(bytes(message), static_cast<word>(message.size()));
+	uint8 result[crypto::sha2_length];
+
+	crypto::hasher hasher(crypto::hash_algorithm::sha2);
+	ASSERT_EQ(hasher.length(), crypto::sha2_length);
+
+	hasher.update(bytes(message), 10);
+	hasher.update(bytes(message) + 10, static_cast<word>(message.size()) - 10);
+	hasher.final(result);
+	EXPECT_EQ(hex(result, crypto::sha2_length), hex(expected.data(), crypto::sha2_length));
+
+	data_stream stream;
+	stream.write(bytes(message), static_cast<word>(message.size()));
+
+	hasher.reset();
+	hasher.update(stream);
+	hasher.final(result);
+	EXPECT_EQ(hex(result, crypto::sha2_length), hex(expected.data(), crypto::sha2_length));
+
+	segmented_stream segments;
+	segments.append(bytes(message), 4);
+	segments.write(bytes(message) + 4, 16);
+	segments.append(bytes(message) + 20, static_cast<word>(message.size()) - 20);
+
+	crypto::hasher moved(move(hasher));
+	moved.reset();
+	moved.update(segments);
+	moved.final(result);
+	EXPECT_EQ(hex(result, crypto::sha2_length), hex(expected.data(), crypto::sha2_length));
+}
+
+TEST(Cryptography, Generator) {
+	vector<uint8> first(5000), second(5000);
+
+	crypto::random_bytes(first.data(), static_cast<word>(first.size()));
+	crypto::random_bytes(second.data(), static_cast<word>(second.size()));
+	EXPECT_NE(first, second);
+
+	word zeroes = 0;
+	for (auto i : first)
+		zeroes += i == 0;
+
+	EXPECT_LT(zeroes, 100U);
+
+	set<uint64> seen;
+	vector<thread> threads;
+	mutex lock;
+
+	for (word i = 0; i < 4; i++) {
+		threads.emplace_back([&seen, &lock] {
+			uint64 value = crypto::generator()();
+
+			unique_lock<mutex> guard(lock);
+			seen.insert(value);
+		});
+	}
+
+	for (auto& i : threads)
+		i.join();
+
+	EXPECT_EQ(seen.size(), 4U);
+
+	for (word i = 0; i < 1000; i++) {
+		int64 value = crypto::random_int64(-5, 5);
+		float64 real = crypto::random_float64(1.0, 2.0);
+
+		EXPECT_TRUE(value >= -5 && value <= 5);
+		EXPECT_TRUE(real >= 1.0 && real < 2.0);
+	}
+}
+
+#ifdef POSIX
+TEST(Cryptography, Fork) {
+	uint64 parent, child = 0;
+	int pipes[2];
+
+	//Leave buffered output behind that the child must not hand out again.
+	crypto::random_uint64(0, ~0ULL);
+
+	ASSERT_EQ(pipe(pipes), 0);
+
+	pid_t id = fork();
+
+	if (id == 0) {
+		child = crypto::generator()();
+
+		_exit(write(pipes[1], &child, sizeof(child)) == sizeof(child) ? 0 : 1);
+	}
+
+	parent = crypto::generator()();
+
+	ASSERT_EQ(read(pipes[0], &child, sizeof(child)), static_cast<ssize_t>(sizeof(child)));
+
+	waitpid(id, nullptr, 0);
+	close(pipes[0]);
+	close(pipes[1]);
+
+	EXPECT_NE(parent, child);
+}
+#endif
+
+TEST(Cryptography, FillUniform) {
+	vector<int64> integers(10001);
+	word buckets[10] = { 0 };
+
+	crypto::fill_uniform_int64(span<int64>(integers.data(), static_cast<word>(integers.size())), -5, 4);
+
+	for (auto i : integers) {
+		ASSERT_TRUE(i >= -5 && i <= 4);
+		buckets[i + 5]++;
+	}
+
+	for (auto i : buckets)
+		EXPECT_TRUE(i > 800 && i < 1200);
+
+	vector<uint64> wide(1001);
+	uint64 floor = 1ULL << 40, ceiling = (1ULL << 40) + (1ULL << 38) + 12345;
+	bool upper_half = false;
+
+	crypto::fill_uniform_uint64(span<uint64>(wide.data(), static_cast<word>(wide.size())), floor, ceiling);
+
+	for (auto i : wide) {
+		ASSERT_TRUE(i >= floor && i <= ceiling);
+		upper_half |= i > floor + (1ULL << 37);
+	}
+
+	EXPECT_TRUE(upper_half);
+
+	crypto::fill_uniform_uint64(span<uint64>(wide.data(), static_cast<word>(wide.size())), 0, ~0ULL);
+	EXPECT_NE(wide[0], wide[1]);
+
+	crypto::fill_uniform_uint64(span<uint64>(wide.data(), 3), 7, 7);
+	EXPECT_EQ(wide[0], 7U);
+	EXPECT_EQ(wide[2], 7U);
+
+	vector<float64> reals(1001);
+	float64 sum = 0;
+
+	crypto::fill_uniform_float64(span<float64>(reals.data(), static_cast<word>(reals.size())), -2.0, 2.0);
+
+	for (auto i : reals) {
+		ASSERT_TRUE(i >= -2.0 && i < 2.0);
+		sum += i;
+	}
+
+	EXPECT_LT(sum / reals.size(), 0.25);
+	EXPECT_GT(sum / reals.size(), -0.25);
+
+	//Half of the products round up to the ceiling of a one ulp wide range.
+	float64 next = std::nextafter(1.0, 2.0);
+
+	crypto::fill_uniform_float64(span<float64>(reals.data(), static_cast<word>(reals.size())), 1.0, next);
+
+	for (auto i : reals)
+		ASSERT_EQ(i, 1.0);
+
+	EXPECT_EQ(crypto::random_float64(1.0, next), 1.0);
+}
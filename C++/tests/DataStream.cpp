@@ -1,9 +1,395 @@
 #include <gtest/gtest.h>
 
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
 #include <Utilities/DataStream.h>
+#include <Utilities/SegmentedStream.h>
 
 using namespace util;
 
 TEST(DataStream, Creation) {
 	data_stream foo;
-}
\ No newline at end of file
+}
+
+TEST(DataStream, InlineAndSpill) {
+	data_stream small;
+
+	for (uint8 i = 0; i < 16; i++)
+		small.write(i);
+
+	data_stream moved(std::move(small));
+	data_stream copied(moved);
+
+	EXPECT_EQ(moved.size(), 16U);
+	EXPECT_EQ(copied.data()[15], 15);
+	EXPECT_EQ(small.size(), 0U);
+
+	for (word i = 0; i < 100; i++)
+		copied.write(static_cast<uint8>(i));
+
+	data_stream large(std::move(copied));
+
+	EXPECT_EQ(large.size(), 116U);
+	EXPECT_EQ(large.data()[15], 15);
+	EXPECT_EQ(large.data()[115], 99);
+
+	large.resize(8);
+
+	EXPECT_EQ(large.size(), 8U);
+	EXPECT_EQ(large.data()[7], 7);
+}
+
+TEST(DataStream, BufferPool) {
+	caching_buffer_pool pool;
+	uint8* first = pool.allocate(256);
+
+	pool.release(first, 256);
+
+	EXPECT_EQ(pool.allocate(256), first);
+
+	pool.release(first, 256);
+
+	data_stream stream(pool);
+
+	for (word i = 0; i < 200; i++)
+		stream.write(static_cast<uint8>(i));
+
+	EXPECT_EQ(stream.data(), first);
+	EXPECT_EQ(stream.data()[199], 199);
+}
+
+TEST(DataStream, BufferPoolsStaySeparate) {
+	caching_buffer_pool first, second;
+	uint8* buffer = first.allocate(256);
+
+	first.release(buffer, 256);
+
+	uint8* other = second.allocate(256);
+
+	EXPECT_NE(other, buffer);
+	EXPECT_EQ(first.allocate(256), buffer);
+
+	first.release(buffer, 256);
+	second.release(other, 256);
+}
+
+TEST(DataStream, CopiesArePooled) {
+	uint8 source[100] = { 0 };
+	const uint8* buffer;
+
+	{
+		data_stream copy(static_cast<const uint8*>(source), sizeof(source));
+		buffer = copy.data();
+	}
+
+	uint8* reused = buffer_pool::shared().allocate(128);
+
+	EXPECT_EQ(reused, buffer);
+
+	buffer_pool::shared().release(reused, 128);
+}
+
+TEST(DataStream, AdoptPooled) {
+	caching_buffer_pool pool;
+	uint8* large = pool.allocate(data_stream::allocation_for(200));
+	uint8* small = pool.allocate(data_stream::allocation_for(10));
+
+	large[199] = 199;
+	small[9] = 9;
+
+	data_stream adopted(large, 200, pool);
+	data_stream inlined(small, 10, pool);
+
+	EXPECT_EQ(adopted.data(), large);
+	EXPECT_EQ(adopted.data()[199], 199);
+	EXPECT_NE(inlined.data(), small);
+	EXPECT_EQ(inlined.data()[9], 9);
+
+	uint8* reused = pool.allocate(data_stream::allocation_for(10));
+
+	EXPECT_EQ(reused, small);
+
+	pool.release(reused, data_stream::allocation_for(10));
+}
+
+namespace {
+	struct exit_releaser {
+		caching_buffer_pool* pool = nullptr;
+		uint8* buffer = nullptr;
+
+		~exit_releaser() {
+			if (this->pool)
+				this->pool->release(this->buffer, 4096);
+		}
+	};
+}
+
+TEST(DataStream, BufferPoolThreadExit) {
+	caching_buffer_pool pool;
+	uint8* released = nullptr;
+	uint8* reused = nullptr;
+
+	//The releaser is created before the thread's cache, so it is destroyed
+	//after it and its buffer has to go back to the pool's depot.
+	std::thread([&pool, &released] {
+		thread_local exit_releaser releaser;
+
+		releaser.pool = &pool;
+		releaser.buffer = released = pool.allocate(4096);
+	}).join();
+
+	std::thread([&pool, &reused] {
+		reused = pool.allocate(4096);
+		pool.release(reused, 4096);
+	}).join();
+
+	EXPECT_EQ(reused, released);
+}
+
+TEST(SegmentedStream, AppendAndWrite) {
+	segmented_stream stream;
+	data_stream body;
+	uint8 external[3] = { 7, 8, 9 };
+
+	body.write(static_cast<uint32>(42));
+
+	stream.write(static_cast<uint16>(1));
+	stream.append(std::move(body));
+	stream.append(external, sizeof(external));
+	stream.write(static_cast<uint8>(5));
+
+	auto& segments = stream.segments();
+
+	ASSERT_EQ(segments.size(), 4U);
+	EXPECT_EQ(stream.size(), 10U);
+	EXPECT_EQ(segments[2].data, external);
+	EXPECT_EQ(segments[3].data, segments[0].data + segments[0].length);
+	EXPECT_EQ(segments[3].data[0], 5);
+
+	for (word i = 0; i < segmented_stream::chunk_size; i++)
+		stream.write(static_cast<uint8>(i));
+
+	EXPECT_EQ(stream.segments().size(), 5U);
+	EXPECT_EQ(stream.size(), 10U + segmented_stream::chunk_size);
+}
+
+TEST(DataStream, Share) {
+	data_stream original;
+
+	for (word i = 0; i < 200; i++)
+		original.write(static_cast<uint8>(i));
+
+	data_stream first = original.share();
+	data_stream second(first);
+
+	EXPECT_EQ(first.data(), original.data());
+	EXPECT_EQ(second.data(), original.data());
+
+	second.seek(0);
+	second.write(static_cast<uint8>(99));
+
+	EXPECT_NE(second.data(), original.data());
+	EXPECT_EQ(second.data()[0], 99);
+	EXPECT_EQ(second.data()[199], 199);
+	EXPECT_EQ(original.data()[0], 0);
+	EXPECT_EQ(first.size(), 200U);
+}
+
+TEST(DataStream, Varint) {
+	data_stream stream;
+
+	stream.write_varint(static_cast<uint32>(1));
+	stream.write_varint(static_cast<uint32>(300));
+	stream.write_varint(static_cast<int32>(-1));
+	stream.write_varint(static_cast<int64>(-5000000000LL));
+	stream.write_varint(static_cast<uint64>(0xFFFFFFFFFFFFFFFFULL));
+
+	EXPECT_EQ(stream.size(), 1U + 2U + 1U + 5U + 10U);
+
+	stream.seek(0);
+
+	EXPECT_EQ(stream.read_varint<uint32>(), 1U);
+	EXPECT_EQ(stream.read_varint<uint32>(), 300U);
+	EXPECT_EQ(stream.read_varint<int32>(), -1);
+	EXPECT_EQ(stream.read_varint<int64>(), -5000000000LL);
+	EXPECT_EQ(stream.read_varint<uint64>(), 0xFFFFFFFFFFFFFFFFULL);
+
+	stream.seek(4);
+
+	EXPECT_THROW(stream.read_varint<int32>(), data_stream::invalid_varint);
+
+	const uint8 overlong[] = { 0x80, 0x00, 0x81, 0x80, 0x00 };
+	data_stream padded(overlong, sizeof(overlong));
+
+	EXPECT_THROW(padded.read_varint<uint32>(), data_stream::invalid_varint);
+	padded.seek(2);
+	EXPECT_THROW(padded.read_varint<uint32>(), data_stream::invalid_varint);
+}
+
+TEST(DataStream, VarintStrings) {
+	data_stream stream;
+
+	stream.set_string_prefix(string_prefix::varint);
+	stream.write(std::string("hello"));
+
+	EXPECT_EQ(stream.size(), 6U);
+
+	stream.seek(0);
+
+	EXPECT_EQ(stream.read_string(), "hello");
+
+	data_stream fixed;
+
+	fixed.write("abc");
+	EXPECT_EQ(fixed.size(), sizeof(word) + 3U);
+
+	stream.write("abc");
+	EXPECT_EQ(stream.size(), 6U + 1U + 3U);
+}
+
+TEST(DataStream, Arrays) {
+	uint32 values[37];
+	uint32 copy[37];
+	uint16 shorts[5] = { 0x0102, 0x0304, 0x0506, 0x0708, 0x090A };
+
+	for (word i = 0; i < 37; i++)
+		values[i] = 0x01020304 + static_cast<uint32>(i);
+
+	data_stream stream;
+
+	stream.write_array(values, 37, endianness::big);
+	stream.write_array(shorts, 5, endianness::little);
+
+	EXPECT_EQ(stream.data()[0], 0x01);
+	EXPECT_EQ(stream.data()[3], 0x04);
+	EXPECT_EQ(stream.data()[36 * 4 + 3], 0x04 + 36);
+	EXPECT_EQ(stream.data()[37 * 4], 0x02);
+
+	stream.seek(0);
+	stream.read_array(copy, 37, endianness::big);
+
+	for (word i = 0; i < 37; i++)
+		EXPECT_EQ(copy[i], values[i]);
+}
+
+TEST(DataStream, MappedFile) {
+	const char* path = "data_stream_mapped.bin";
+	uint32 values[100];
+
+	for (word i = 0; i < 100; i++)
+		values[i] = static_cast<uint32>(i);
+
+	FILE* file = fopen(path, "wb");
+	fwrite(values, sizeof(values), 1, file);
+	fclose(file);
+
+	{
+		data_stream stream(mapped_file(path, false, access_pattern::sequential));
+		const uint8* mapped = stream.data();
+
+		EXPECT_EQ(stream.size(), sizeof(values));
+
+		stream.seek(40);
+		EXPECT_EQ(stream.read<uint32>(), 10U);
+
+		stream.seek(0);
+		stream.write(static_cast<uint32>(7));
+
+		EXPECT_NE(stream.data(), mapped);
+		EXPECT_EQ(stream.size(), sizeof(values));
+		EXPECT_EQ(reinterpret_cast<const uint32*>(stream.data())[99], 99U);
+	}
+
+	{
+		data_stream stream(mapped_file(path, true));
+
+		stream.write(static_cast<uint32>(42));
+	}
+
+	data_stream reloaded(mapped_file(path, false));
+
+	EXPECT_EQ(reloaded.read<uint32>(), 42U);
+
+	remove(path);
+}
+
+TEST(DataStream, MappedFileWholeWrite) {
+	const char* path = "data_stream_mapped_whole.bin";
+	uint8 contents[100] = { 0 };
+
+	FILE* file = fopen(path, "wb");
+	fwrite(contents, sizeof(contents), 1, file);
+	fclose(file);
+
+	for (word i = 0; i < sizeof(contents); i++)
+		contents[i] = static_cast<uint8>(i + 1);
+
+	{
+		data_stream stream(mapped_file(path, true));
+		const uint8* mapped = stream.data();
+
+		stream.write(contents, sizeof(contents));
+
+		EXPECT_EQ(stream.data(), mapped);
+		EXPECT_EQ(stream.size(), sizeof(contents));
+	}
+
+	uint8 stored[100] = { 0 };
+
+	file = fopen(path, "rb");
+	ASSERT_EQ(fread(stored, sizeof(stored), 1, file), 1U);
+	fclose(file);
+
+	EXPECT_EQ(memcmp(stored, contents, sizeof(contents)), 0);
+
+	remove(path);
+}
+
+TEST(DataStream, Reader) {
+	data_stream stream;
+
+	stream << static_cast<uint16>(513) << static_cast<uint8>(3) << static_cast<uint8>(4) << static_cast<uint32>(9);
+	stream.seek(0);
+
+	uint16 id;
+	uint8 category, method;
+	auto header = stream.read_region(4);
+
+	header >> id >> category >> method;
+
+	EXPECT_EQ(id, 513);
+	EXPECT_EQ(category, 3);
+	EXPECT_EQ(method, 4);
+	EXPECT_EQ(header.remaining(), 0U);
+	EXPECT_EQ(stream.position(), 4U);
+	EXPECT_THROW(stream.read_region(5), data_stream::read_past_end_exception);
+}
+
+TEST(DataStream, Views) {
+	data_stream stream;
+	uint8 bytes[] = { 1, 2, 3 };
+
+	stream << std::string("hello") << std::string("h\xC3\xA9llo");
+	stream.write(bytes, 3);
+	stream.write(std::string("\xFF"));
+	stream.seek(0);
+
+	string_view first = stream.read_string_view();
+	EXPECT_EQ(first, "hello");
+	EXPECT_EQ(first.to_string(), std::string("hello"));
+	EXPECT_EQ(std::hash<string_view>()(first), std::hash<string_view>()(string_view(std::string("hello"))));
+
+	string_view second = stream.read_utf8_view();
+	EXPECT_EQ(second.size(), 6U);
+	EXPECT_TRUE(first.data() >= reinterpret_cast<cstr>(stream.data()) && second.end() <= reinterpret_cast<cstr>(stream.data() + stream.size()));
+
+	auto region = stream.read_span(3);
+	ASSERT_EQ(region.size(), 3U);
+	EXPECT_EQ(region[2], 3);
+	EXPECT_EQ(region.data(), stream.data_at_cursor() - 3);
+
+	EXPECT_THROW(stream.read_utf8_view(), data_stream::string_not_utf8);
+	EXPECT_THROW(stream.read_span(1), data_stream::read_past_end_exception);
+}
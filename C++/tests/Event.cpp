@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+#include <atomic>
+
+#include <Utilities/Event.h>
+
+using namespace util;
+
+TEST(Event, AddAndRemove) {
+	event<int> changed;
+	int total = 0;
+
+	auto first = changed += [&total](int value) { total += value; };
+	changed += [&total](int value) { total += value * 10; };
+
+	changed(1);
+	EXPECT_EQ(total, 11);
+
+	EXPECT_TRUE(changed -= first);
+	EXPECT_FALSE(changed -= first);
+
+	changed(1);
+	EXPECT_EQ(total, 21);
+}
+
+TEST(Event, RemoveWhileFiring) {
+	event<> fired;
+	event<>::token_type token;
+	int calls = 0;
+
+	token = fired += [&fired, &token, &calls]() {
+		calls++;
+		fired -= token;
+	};
+
+	fired();
+	fired();
+
+	EXPECT_EQ(calls, 1);
+}
+
+TEST(Event, FireWhileChanging) {
+	event<int> changed;
+	std::atomic<int> total(0);
+	std::vector<std::thread> firers;
+
+	changed += [&total](int value) { total += value; };
+
+	for (int i = 0; i < 4; i++) {
+		firers.emplace_back([&changed] {
+			for (int j = 0; j < 10000; j++)
+				changed(1);
+		});
+	}
+
+	for (int i = 0; i < 1000; i++) {
+		auto token = changed += [](int) {};
+
+		changed -= token;
+	}
+
+	for (auto& i : firers)
+		i.join();
+
+	EXPECT_EQ(total, 40000);
+}
+
+namespace {
+	struct counter {
+		int total = 0;
+
+		int add(int value) {
+			return this->total += value;
+		}
+	};
+}
+
+TEST(Delegate, MemberAndLambda) {
+	counter target;
+	delegate<int(int)> bound(&target, &counter::add);
+
+	EXPECT_EQ(bound(2), 2);
+	EXPECT_EQ(bound(3), 5);
+
+	int captured = 7;
+	delegate<int(int)> lambda([captured](int value) { return captured + value; });
+	delegate<int(int)> copy(lambda);
+
+	EXPECT_EQ(copy(1), 8);
+	EXPECT_FALSE(delegate<int(int)>());
+}
+
+TEST(Delegate, LargeCallable) {
+	char padding[delegate<int()>::inline_size * 2] = { 1 };
+	delegate<int()> large([padding]() { return static_cast<int>(padding[0]); });
+	delegate<int()> moved(std::move(large));
+
+	EXPECT_EQ(moved(), 1);
+	EXPECT_FALSE(large);
+}
@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include <Utilities/Locked.h>
+
+using namespace std;
+using namespace util;
+
+TEST(Locked, SharedLocked) {
+	int value = 1;
+	shared_locked<int> item(&value);
+
+	{
+		auto first = item.read();
+		auto second = item.read();
+
+		EXPECT_EQ(*first + *second, 2);
+	}
+
+	*item.write() = 5;
+
+	EXPECT_EQ(*item.read(), 5);
+}
+
+TEST(Locked, Seqlock) {
+	struct pair {
+		word first;
+		word second;
+	};
+
+	seqlock<pair> item(pair { 0, 0 });
+	bool consistent = true;
+
+	thread writer([&item]() {
+		for (word i = 1; i <= 10000; i++)
+			item.store(pair { i, i });
+	});
+
+	for (word i = 0; i < 10000; i++) {
+		pair current = item.load();
+
+		if (current.first != current.second)
+			consistent = false;
+	}
+
+	writer.join();
+
+	EXPECT_TRUE(consistent);
+	EXPECT_EQ(item.load().first, 10000U);
+}
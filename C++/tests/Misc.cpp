@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <Utilities/Misc.h>
+
+using namespace util;
+
+TEST(Misc, UTF8Valid) {
+	EXPECT_TRUE(misc::is_string_utf8(std::string()));
+	EXPECT_TRUE(misc::is_string_utf8(std::string("plain ascii")));
+	EXPECT_TRUE(misc::is_string_utf8(std::string("h\xC3\xA9llo \xE2\x82\xAC \xF0\x9F\x98\x80 \xF4\x8F\xBF\xBF \xED\x9F\xBF")));
+}
+
+TEST(Misc, UTF8Invalid) {
+	EXPECT_FALSE(misc::is_string_utf8(std::string("\xF8\x88\x80\x80\x80")));
+	EXPECT_FALSE(misc::is_string_utf8(std::string("\xC0\xAF")));
+	EXPECT_FALSE(misc::is_string_utf8(std::string("\xE0\x80\xAF")));
+	EXPECT_FALSE(misc::is_string_utf8(std::string("\xF0\x80\x80\xAF")));
+	EXPECT_FALSE(misc::is_string_utf8(std::string("\xED\xA0\x80")));
+	EXPECT_FALSE(misc::is_string_utf8(std::string("\xF4\x90\x80\x80")));
+	EXPECT_FALSE(misc::is_string_utf8(std::string("\x80")));
+	EXPECT_FALSE(misc::is_string_utf8(std::string("\xE2\x82")));
+}
+
+TEST(Misc, UTF8Blocks) {
+	std::string euro("\xE2\x82\xAC");
+
+	for (word length = 60; length < 72; length++) {
+		for (word position = 0; position + 3 <= length; position++) {
+			std::string text(length, 'a');
+			text.replace(position, 3, euro);
+
+			EXPECT_TRUE(misc::is_string_utf8(text)) << length << " " << position;
+
+			text[position + 2] = 'a';
+			EXPECT_FALSE(misc::is_string_utf8(text)) << length << " " << position;
+
+			text[position + 2] = '\xAC';
+			text.resize(position + 2);
+			EXPECT_FALSE(misc::is_string_utf8(reinterpret_cast<const uint8*>(text.data()), static_cast<word>(text.size()))) << length << " " << position;
+		}
+	}
+}
+
+TEST(Misc, Base64Vectors) {
+	cstr encoded[] = { "", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy" };
+	std::string text("foobar");
+
+	for (word i = 0; i <= text.size(); i++) {
+		EXPECT_EQ(misc::base64_encode(reinterpret_cast<const uint8*>(text.data()), i), encoded[i]);
+
+		auto decoded = misc::base64_decode(encoded[i]);
+		EXPECT_EQ(std::string(decoded.begin(), decoded.end()), text.substr(0, i));
+	}
+
+	uint8 bytes[] = { 0xFB, 0xFF };
+	EXPECT_EQ(misc::base64_encode(bytes, 2), "+/8=");
+	EXPECT_EQ(misc::base64_encode(bytes, 2, misc::base64_alphabet::url, false), "-_8");
+	EXPECT_EQ(misc::base64_decode("-_8", misc::base64_alphabet::url), std::vector<uint8>(bytes, bytes + 2));
+}
+
+TEST(Misc, Base64RoundTrip) {
+	std::vector<uint8> data(300);
+
+	for (word i = 0; i < data.size(); i++)
+		data[i] = static_cast<uint8>(i * 131 + 7);
+
+	for (auto alphabet : { misc::base64_alphabet::standard, misc::base64_alphabet::url }) {
+		for (word length = 0; length <= data.size(); length++) {
+			for (bool padding : { true, false }) {
+				std::string encoded = misc::base64_encode(data.data(), length, alphabet, padding);
+
+				ASSERT_EQ(encoded.size(), misc::base64_encoded_size(length, padding));
+				ASSERT_EQ(misc::base64_decode(encoded, alphabet), std::vector<uint8>(data.begin(), data.begin() + length)) << length;
+			}
+		}
+	}
+}
+
+TEST(Misc, Base64Invalid) {
+	std::string encoded = misc::base64_encode(reinterpret_cast<const uint8*>(std::string(150, 'x').data()), 150);
+
+	EXPECT_THROW(misc::base64_decode("Zm9v!"), misc::invalid_base64);
+	EXPECT_THROW(misc::base64_decode("Zm9vY"), misc::invalid_base64);
+	EXPECT_THROW(misc::base64_decode("Zg=a"), misc::invalid_base64);
+	EXPECT_THROW(misc::base64_decode("Zh=="), misc::invalid_base64);
+	EXPECT_THROW(misc::base64_decode("Zm9=Zm9v"), misc::invalid_base64);
+	EXPECT_THROW(misc::base64_decode("-_8", misc::base64_alphabet::standard), misc::invalid_base64);
+
+	encoded[100] = '*';
+	EXPECT_THROW(misc::base64_decode(encoded), misc::invalid_base64);
+}
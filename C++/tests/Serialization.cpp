@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+#include <tuple>
+
+#include <Utilities/Serialization.h>
+
+using namespace std;
+using namespace util;
+
+namespace {
+	struct point {
+		int32 x;
+		int32 y;
+
+		static auto fields() {
+			return make_tuple(&point::x, &point::y);
+		}
+	};
+
+	struct route {
+		uint16 id;
+		string name;
+		vector<point> points;
+		float64 length;
+
+		static auto fields() {
+			return make_tuple(&route::id, &route::name, &route::points, &route::length);
+		}
+	};
+}
+
+TEST(Serialization, RoundTrip) {
+	route original { 7, "north", { { 1, 2 }, { 3, 4 } }, 2.5 };
+	data_stream stream;
+
+	EXPECT_EQ(serialization::encoded_size(original), 2U + 2U + 5U + 2U + 16U + 8U);
+
+	serialization::write(stream, original);
+
+	EXPECT_EQ(stream.size(), serialization::encoded_size(original));
+
+	stream.seek(0);
+
+	EXPECT_EQ(stream.read<uint16>(), 7);
+	EXPECT_EQ(stream.read_string(), "north");
+
+	stream.seek(0);
+
+	auto copy = serialization::read<route>(stream);
+
+	EXPECT_EQ(copy.id, 7);
+	EXPECT_EQ(copy.name, "north");
+	ASSERT_EQ(copy.points.size(), 2U);
+	EXPECT_EQ(copy.points[1].y, 4);
+	EXPECT_EQ(copy.length, 2.5);
+	EXPECT_EQ(stream.position(), stream.size());
+}
+
+TEST(Serialization, Truncated) {
+	route original { 7, "north", { { 1, 2 } }, 2.5 };
+	data_stream stream;
+
+	serialization::write(stream, original);
+	stream.shrink_written(stream.size() - 1);
+	stream.seek(0);
+
+	EXPECT_THROW(serialization::read<route>(stream), data_stream::read_past_end_exception);
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include <Utilities/TimerWheel.h>
+
+using namespace std;
+using namespace util;
+
+TEST(TimerWheel, OneShotAndCancel) {
+	chrono::microseconds now(0);
+	timer_wheel wheel(chrono::milliseconds(1), 1, [&now] { return now; });
+	word fired = 0;
+
+	wheel.schedule(chrono::milliseconds(5), [&fired] { fired++; });
+	wheel.schedule(chrono::milliseconds(300), [&fired] { fired++; });
+	auto cancelled = wheel.schedule(chrono::milliseconds(5), [&fired] { fired += 100; });
+
+	EXPECT_TRUE(wheel.cancel(cancelled));
+	EXPECT_FALSE(wheel.cancel(cancelled));
+
+	now = chrono::milliseconds(4);
+	wheel.poll();
+	EXPECT_EQ(fired, 0U);
+
+	now = chrono::milliseconds(5);
+	wheel.poll();
+	EXPECT_EQ(fired, 1U);
+
+	now = chrono::milliseconds(299);
+	wheel.poll();
+	EXPECT_EQ(fired, 1U);
+
+	now = chrono::milliseconds(300);
+	wheel.poll();
+	EXPECT_EQ(fired, 2U);
+}
+
+TEST(TimerWheel, FixedRate) {
+	chrono::microseconds now(0);
+	timer_wheel wheel(chrono::milliseconds(1), 1, [&now] { return now; });
+	word fired = 0;
+
+	auto id = wheel.schedule_every(chrono::milliseconds(10), [&fired] { fired++; });
+
+	//Polling late must still fire once per period rather than drift.
+	for (word i = 1; i <= 135; i++) {
+		now = chrono::milliseconds(3 * i);
+		wheel.poll();
+	}
+
+	EXPECT_TRUE(wheel.cancel(id));
+	EXPECT_EQ(fired, 40U);
+	EXPECT_THROW(wheel.schedule_every(chrono::microseconds(500), [] {}), timer_wheel::period_too_short);
+}
+
+TEST(TimerWheel, Started) {
+	timer_wheel wheel(chrono::milliseconds(1));
+	atomic<word> fired(0);
+
+	wheel.start();
+	wheel.schedule(chrono::milliseconds(2), [&fired] { fired++; });
+
+	auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+
+	while (fired == 0 && chrono::steady_clock::now() < deadline)
+		this_thread::yield();
+
+	EXPECT_EQ(fired, 1U);
+}
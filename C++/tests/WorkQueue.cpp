@@ -0,0 +1,299 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <ctime>
+
+#include <Utilities/WorkQueue.h>
+#include <Utilities/RingQueue.h>
+#include <Utilities/WorkProcessor.h>
+
+using namespace std;
+using namespace util;
+
+TEST(WorkQueue, OverflowPolicies) {
+	work_queue<int> rejecting(2, overflow_policy::reject);
+
+	EXPECT_TRUE(rejecting.enqueue(1));
+	EXPECT_TRUE(rejecting.enqueue(2));
+	EXPECT_FALSE(rejecting.enqueue(3));
+	EXPECT_EQ(rejecting.size(), 2U);
+
+	work_queue<int> dropping(2, overflow_policy::drop_oldest);
+
+	EXPECT_TRUE(dropping.enqueue(1));
+	EXPECT_TRUE(dropping.enqueue(2));
+	EXPECT_TRUE(dropping.enqueue(3));
+	EXPECT_EQ(dropping.dequeue(), 2);
+	EXPECT_EQ(dropping.high_watermark(), 2U);
+
+	work_queue<int> blocking(1, overflow_policy::block);
+
+	EXPECT_TRUE(blocking.enqueue(1));
+
+	thread producer([&blocking] {
+		EXPECT_TRUE(blocking.enqueue(2));
+	});
+
+	EXPECT_EQ(blocking.dequeue(), 1);
+	EXPECT_EQ(blocking.dequeue(), 2);
+
+	producer.join();
+}
+
+TEST(WorkQueue, StrictLanes) {
+	work_queue<int> queue;
+
+	queue.set_lanes(lane_scheduler(2, lane_policy::strict, vector<word>(), 2));
+
+	for (int i = 0; i < 4; i++) {
+		queue.enqueue(move(i), 1);
+		queue.enqueue(i + 10, 0);
+	}
+
+	EXPECT_EQ(queue.dequeue(), 10);
+	EXPECT_EQ(queue.dequeue(), 11);
+	EXPECT_EQ(queue.dequeue(), 0);
+	EXPECT_EQ(queue.dequeue(), 12);
+	EXPECT_EQ(queue.dequeue(), 13);
+	EXPECT_EQ(queue.dequeue(), 1);
+}
+
+TEST(WorkQueue, WeightedLanes) {
+	work_queue<int> queue;
+	int served[2] = { 0, 0 };
+
+	queue.set_lanes(lane_scheduler(2, lane_policy::weighted, vector<word>{ 3, 1 }));
+
+	for (int i = 0; i < 100; i++) {
+		queue.enqueue(0, 0);
+		queue.enqueue(1, 1);
+	}
+
+	for (int i = 0; i < 40; i++)
+		served[queue.dequeue()]++;
+
+	EXPECT_EQ(served[0], 30);
+	EXPECT_EQ(served[1], 10);
+}
+
+TEST(WorkQueue, MovedFromLanes) {
+	work_queue<int> source;
+
+	source.set_lanes(lane_scheduler(3));
+	source.enqueue(1, 2);
+
+	work_queue<int> target(move(source));
+
+	EXPECT_EQ(target.dequeue(), 1);
+
+	for (int i = 0; i < 3; i++)
+		EXPECT_TRUE(source.enqueue(move(i), static_cast<word>(i)));
+
+	EXPECT_EQ(source.dequeue(), 0);
+	EXPECT_EQ(source.dequeue(), 1);
+	EXPECT_EQ(source.dequeue(), 2);
+}
+
+TEST(RingQueue, Bounded) {
+	ring_queue<int> queue(3);
+
+	EXPECT_EQ(queue.capacity(), 4U);
+
+	for (int i = 0; i < 4; i++)
+		EXPECT_TRUE(queue.try_enqueue(move(i)));
+
+	EXPECT_FALSE(queue.try_enqueue(4));
+
+	int item;
+	for (int i = 0; i < 4; i++) {
+		EXPECT_TRUE(queue.try_dequeue(item));
+		EXPECT_EQ(item, i);
+	}
+
+	EXPECT_FALSE(queue.try_dequeue(item));
+}
+
+TEST(RingQueue, ManyProducers) {
+	ring_queue<word> queue(64);
+	atomic<word> sum(0);
+	vector<thread> threads;
+
+	for (word i = 0; i < 4; i++) {
+		threads.emplace_back([&queue] {
+			for (word j = 1; j <= 1000; j++)
+				queue.enqueue(move(j));
+		});
+
+		threads.emplace_back([&queue, &sum] {
+			for (word j = 0; j < 1000; j++)
+				sum += queue.dequeue();
+		});
+	}
+
+	for (auto& i : threads)
+		i.join();
+
+	EXPECT_EQ(sum, 4U * 500500U);
+}
+
+TEST(RingQueue, KillWaiters) {
+	ring_queue<int> queue;
+	int item;
+
+	thread waiter([&queue, &item] {
+		EXPECT_FALSE(queue.dequeue(item));
+	});
+
+	queue.kill_waiters();
+	waiter.join();
+}
+
+TEST(WorkProcessor, WorkStealing) {
+	work_processor<word> processor(4, chrono::microseconds(0), work_scheduling::work_stealing);
+	atomic<word> processed(0);
+
+	processor.on_item += [&processor, &processed](word, word& item) {
+		if (item > 1)
+			processor.add_work(item - 1);
+
+		processed++;
+	};
+
+	processor.start();
+
+	for (word i = 0; i < 100; i++)
+		processor.add_work(10);
+
+	while (processed < 1000)
+		this_thread::yield();
+
+	processor.stop();
+
+	EXPECT_EQ(processed, 1000U);
+}
+
+TEST(WorkProcessor, WorkStealingOrder) {
+	work_processor<word> processor(1, chrono::microseconds(0), work_scheduling::work_stealing);
+	vector<word> order;
+	atomic<word> processed(0);
+
+	processor.on_item += [&order, &processed](word, word& item) {
+		order.push_back(item);
+		processed++;
+	};
+
+	for (word i = 0; i < 100; i++)
+		processor.add_work(move(i));
+
+	processor.start();
+
+	while (processed < 100)
+		this_thread::yield();
+
+	processor.stop();
+
+	for (word i = 0; i < 100; i++)
+		EXPECT_EQ(order[i], i);
+}
+
+TEST(WorkProcessor, Batches) {
+	work_processor<word> processor(2);
+	atomic<word> processed(0);
+	atomic<word> largest(0);
+
+	processor.set_batch_size(16);
+	processor.on_batch += [&processed, &largest](word, vector<word>& items) {
+		if (items.size() > largest)
+			largest = items.size();
+
+		processed += items.size();
+	};
+
+	for (word i = 0; i < 1000; i++)
+		processor.add_work(move(i));
+
+	processor.start();
+
+	while (processed < 1000)
+		this_thread::yield();
+
+	processor.stop();
+
+	EXPECT_EQ(largest, 16U);
+}
+
+TEST(WorkProcessor, Capacity) {
+	work_processor<word> processor(2, chrono::microseconds(0), work_scheduling::work_stealing);
+
+	processor.set_capacity(4, overflow_policy::reject);
+
+	for (word i = 0; i < 4; i++)
+		EXPECT_TRUE(processor.add_work(move(i)));
+
+	EXPECT_FALSE(processor.add_work(4));
+	EXPECT_EQ(processor.size(), 4U);
+	EXPECT_EQ(processor.high_watermark(), 4U);
+}
+
+TEST(WorkProcessor, Statistics) {
+	work_processor<word> processor(1);
+	atomic<word> processed(0);
+
+	processor.set_spin_limit(8);
+	processor.on_item += [&processed](word, word&) {
+		processed++;
+	};
+
+	processor.start();
+
+	for (word i = 0; i < 100; i++)
+		processor.add_work(move(i));
+
+	while (processed < 100)
+		this_thread::yield();
+
+	this_thread::sleep_for(chrono::milliseconds(10));
+
+	processor.stop();
+
+	auto statistics = processor.statistics(0);
+
+	EXPECT_EQ(statistics.items, 100U);
+	EXPECT_GT(statistics.idle.count(), 0);
+}
+
+TEST(WorkProcessor, Restart) {
+	for (auto scheduling : { work_scheduling::shared, work_scheduling::work_stealing }) {
+		work_processor<word> processor(2, chrono::microseconds(0), scheduling);
+		atomic<word> processed(0);
+
+		processor.on_item += [&processed](word, word&) {
+			processed++;
+		};
+
+		processor.start();
+		processor.stop();
+		processor.start();
+
+		//Restarted workers must park again rather than spin on a dead queue.
+		auto cpu = clock();
+
+		this_thread::sleep_for(chrono::milliseconds(100));
+
+		EXPECT_LT(clock() - cpu, CLOCKS_PER_SEC / 20);
+
+		for (word i = 0; i < 100; i++)
+			processor.add_work(move(i));
+
+		auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+
+		while (processed < 100 && chrono::steady_clock::now() < deadline)
+			this_thread::yield();
+
+		processor.stop();
+
+		EXPECT_EQ(processed, 100U);
+	}
+}